@@ -3,12 +3,171 @@
  *
  * This software may be modified and distributed under the terms
  * of the MIT license.  See the LICENSE file for details.
+ *
+ * The backends are compiled as part of this file so they can stay static.
+ * They are only reached through the tui_backend they define.
  */
 
+#include "backend.h"
+#include <stddef.h>
+
+#include "backend/ansi.c"
+#include "backend/backend_headless.c"
+
 #if   defined(_WIN32)
 #include "backend/backend_win32.c"
+#define TUI_BACKEND_TERMINAL (&backend_win32)
 #elif defined(__linux__)
 #include "backend/backend_posix.c"
+#define TUI_BACKEND_TERMINAL (&backend_posix)
 #else
 #error "Only real computers are supported."
 #endif
+
+static const tui_backend* backend = TUI_BACKEND_TERMINAL;
+
+const tui_backend* tui_terminal_backend(void){
+	return TUI_BACKEND_TERMINAL;
+}
+
+const tui_backend* tui_get_backend(void){
+	return backend;
+}
+
+void tui_set_backend(const tui_backend* b){
+	if (!b){
+		b = TUI_BACKEND_TERMINAL;
+	}
+	if (b == backend){
+		return;
+	}
+	backend->flush();
+	backend = b;
+}
+
+void tui_attron(tui_style attr){
+	tui_style cur = backend->attrget() | (attr & TUI_STYLE_FLAGS);
+
+	if (TUI_STYLE_FG_MODE(attr) != TUI_COLOR_DEFAULT){
+		cur = (cur & ~TUI_STYLE_FG) | (attr & TUI_STYLE_FG);
+	}
+	if (TUI_STYLE_BG_MODE(attr) != TUI_COLOR_DEFAULT){
+		cur = (cur & ~TUI_STYLE_BG) | (attr & TUI_STYLE_BG);
+	}
+	backend->attrset(cur);
+}
+
+void tui_attroff(tui_style attr){
+	tui_style cur = backend->attrget() & ~(attr & TUI_STYLE_FLAGS);
+
+	// TUI_FG_BRIGHT by itself only drops the bright half of a standard color, leaving its base color
+	if ((attr & TUI_STYLE_FG) == TUI_FG_BRIGHT){
+		if (TUI_STYLE_FG_MODE(cur) == TUI_COLOR_16){
+			cur &= ~(TUI_FG_BRIGHT ^ TUI_FG_16(0));
+		}
+	}
+	else if (TUI_STYLE_FG_MODE(attr) != TUI_COLOR_DEFAULT){
+		cur &= ~TUI_STYLE_FG;
+	}
+	if ((attr & TUI_STYLE_BG) == TUI_BG_BRIGHT){
+		if (TUI_STYLE_BG_MODE(cur) == TUI_COLOR_16){
+			cur &= ~(TUI_BG_BRIGHT ^ TUI_BG_16(0));
+		}
+	}
+	else if (TUI_STYLE_BG_MODE(attr) != TUI_COLOR_DEFAULT){
+		cur &= ~TUI_STYLE_BG;
+	}
+	backend->attrset(cur);
+}
+
+void tui_attrclear(void){
+	backend->attrclear();
+}
+
+void tui_attrset(tui_style attr){
+	backend->attrset(attr);
+}
+
+int tui_getcols(void){
+	return backend->getcols();
+}
+
+int tui_getrows(void){
+	return backend->getrows();
+}
+
+int tui_resized(void){
+	return backend->resized();
+}
+
+int tui_resize_fd(void){
+	return backend->resize_fd();
+}
+
+void tui_showcursor(int enable){
+	backend->showcursor(enable);
+}
+
+int tui_setecho(int enable){
+	return backend->setecho(enable);
+}
+
+void tui_setcursorpos(int row, int col){
+	backend->setcursorpos(row, col);
+}
+
+void tui_movecursorpos(int row_delta, int col_delta){
+	backend->movecursorpos(row_delta, col_delta);
+}
+
+void tui_movecursor(int from_row, int from_col, int to_row, int to_col){
+	backend->movecursor(from_row, from_col, to_row, to_col);
+}
+
+int tui_movecost(int from_row, int from_col, int to_row, int to_col){
+	return backend->movecost(from_row, from_col, to_row, to_col);
+}
+
+void tui_clear(void){
+	backend->clear();
+}
+
+int tui_scroll(int top, int bot, int n){
+	return backend->scroll(top, bot, n);
+}
+
+int tui_sync(int begin){
+	return backend->sync(begin);
+}
+
+int tui_write(const char* buf, size_t len){
+	return backend->write(buf, len);
+}
+
+int tui_flush(void){
+	return backend->flush();
+}
+
+void tui_set_esc_timeout(int ms){
+	backend->set_esc_timeout(ms);
+}
+
+int tui_input_begin(void){
+	return backend->input_begin();
+}
+
+int tui_input_end(void){
+	return backend->input_end();
+}
+
+int tui_getkeys(int* keys, size_t n){
+	return backend->getkeys(keys, n);
+}
+
+int tui_input_timeout(void){
+	return backend->input_timeout();
+}
+
+int tui_getch(void){
+	return backend->getch();
+}
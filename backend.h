@@ -9,35 +9,70 @@
 #define __TUI_BACKEND_H
 
 #include "attribute.h"
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * @brief Packed attributes: flags, a foreground color and a background color in 8 bytes.
+ * Bits 0-7 are flags (TUI_BOLD, ...).
+ * Bits 8-9 and 10-11 say how the foreground and background colors are given (TUI_COLOR_*).
+ * Bits 16-39 and 40-63 hold the foreground and background colors themselves.<br>
+ * Every part has bits of its own, so a style is built by combining the values below with '|',
+ * with at most one foreground and one background color:
+ * ```C
+ * tui_style s = TUI_BOLD | TUI_FG_RGB(255, 128, 0) | TUI_BG_256(236);
+ * ```
+ */
+typedef uint64_t tui_style;
+
+#define TUI_COLOR_DEFAULT (0) /**< The terminal's default color. */
+#define TUI_COLOR_16      (1) /**< One of the 16 standard colors. 8-15 are the bright versions of 0-7. */
+#define TUI_COLOR_256     (2) /**< One of the 256 xterm colors. */
+#define TUI_COLOR_RGB     (3) /**< A 24-bit color. */
+
+#define TUI_STYLE_FLAGS ((tui_style)0xFF) /**< Every flag bit of a style. */
+#define TUI_STYLE_FG    (((tui_style)0x3 << 8) | ((tui_style)0xFFFFFF << 16))  /**< Every foreground bit of a style. */
+#define TUI_STYLE_BG    (((tui_style)0x3 << 10) | ((tui_style)0xFFFFFF << 40)) /**< Every background bit of a style. */
+
+#define TUI_STYLE_FG_MODE(s)  ((int)(((s) >> 8) & 0x3))              /**< How the foreground color of a style is given. */
+#define TUI_STYLE_BG_MODE(s)  ((int)(((s) >> 10) & 0x3))             /**< How the background color of a style is given. */
+#define TUI_STYLE_FG_VALUE(s) ((uint32_t)(((s) >> 16) & 0xFFFFFF))   /**< The foreground color index, or 0xRRGGBB. */
+#define TUI_STYLE_BG_VALUE(s) ((uint32_t)(((s) >> 40) & 0xFFFFFF))   /**< The background color index, or 0xRRGGBB. */
+
+#define TUI_FG_16(n)        (((tui_style)TUI_COLOR_16 << 8) | ((tui_style)((n) & 0xF) << 16))   /**< Standard foreground color n (0-15) */
+#define TUI_FG_256(n)       (((tui_style)TUI_COLOR_256 << 8) | ((tui_style)((n) & 0xFF) << 16)) /**< xterm foreground color n (0-255) */
+#define TUI_FG_RGB(r, g, b) (((tui_style)TUI_COLOR_RGB << 8) | ((tui_style)((((r) & 0xFF) << 16) | (((g) & 0xFF) << 8) | ((b) & 0xFF)) << 16)) /**< 24-bit foreground color */
+#define TUI_BG_16(n)        (((tui_style)TUI_COLOR_16 << 10) | ((tui_style)((n) & 0xF) << 40))   /**< Standard background color n (0-15) */
+#define TUI_BG_256(n)       (((tui_style)TUI_COLOR_256 << 10) | ((tui_style)((n) & 0xFF) << 40)) /**< xterm background color n (0-255) */
+#define TUI_BG_RGB(r, g, b) (((tui_style)TUI_COLOR_RGB << 10) | ((tui_style)((((r) & 0xFF) << 16) | (((g) & 0xFF) << 8) | ((b) & 0xFF)) << 40)) /**< 24-bit background color */
+
 #define TUI_NORMAL     (0)       /**< Normal attribute. Only valid by itself. */
 #define TUI_BOLD       (1 << 0)  /**< Make colors more visible. */
 #define TUI_UNDERLINE  (1 << 1)  /**< Underline. Typically not supported in pure text environments. */
 #define TUI_BLINK      (1 << 2)  /**< Blinking text. Does not work on Windows. */
 #define TUI_INVERT     (1 << 3)  /**< Swap the foreground and background */
 
-#define TUI_FG_DEFAULT (1 << 4)  /**< Default foreground (text) color */
-#define TUI_FG_BLACK   (1 << 5)  /**< Black foreground */
-#define TUI_FG_RED     (1 << 6)  /**< Red foreground */
-#define TUI_FG_GREEN   (1 << 7)  /**< Green foreground */
-#define TUI_FG_YELLOW  (1 << 8)  /**< Yellow foreground */
-#define TUI_FG_BLUE    (1 << 9)  /**< Blue foreground */
-#define TUI_FG_MAGENTA (1 << 10) /**< Magenta foreground */
-#define TUI_FG_CYAN    (1 << 11) /**< Cyan foreground */
-#define TUI_FG_WHITE   (1 << 12) /**< White foreground */
-#define TUI_FG_BRIGHT  (1 << 13) /**< Combine with another foreground color to brighten it. Not supported on all terminals. */
-
-#define TUI_BG_DEFAULT (1 << 14) /**< Default background color */
-#define TUI_BG_BLACK   (1 << 15) /**< Black foreground */
-#define TUI_BG_RED     (1 << 16) /**< Red foreground */
-#define TUI_BG_GREEN   (1 << 17) /**< Green foreground */
-#define TUI_BG_YELLOW  (1 << 18) /**< Yellow foreground */
-#define TUI_BG_BLUE    (1 << 19) /**< Blue foreground */
-#define TUI_BG_MAGENTA (1 << 20) /**< Magenta foreground */
-#define TUI_BG_CYAN    (1 << 21) /**< Cyan foreground */
-#define TUI_BG_WHITE   (1 << 22) /**< White foreground */
-#define TUI_BG_BRIGHT  (1 << 23) /**< Combine with any other background color to brighten it. Not supported on all terminals. */
+#define TUI_FG_DEFAULT (0)            /**< Default foreground (text) color */
+#define TUI_FG_BLACK   TUI_FG_16(0)   /**< Black foreground */
+#define TUI_FG_RED     TUI_FG_16(1)   /**< Red foreground */
+#define TUI_FG_GREEN   TUI_FG_16(2)   /**< Green foreground */
+#define TUI_FG_YELLOW  TUI_FG_16(3)   /**< Yellow foreground */
+#define TUI_FG_BLUE    TUI_FG_16(4)   /**< Blue foreground */
+#define TUI_FG_MAGENTA TUI_FG_16(5)   /**< Magenta foreground */
+#define TUI_FG_CYAN    TUI_FG_16(6)   /**< Cyan foreground */
+#define TUI_FG_WHITE   TUI_FG_16(7)   /**< White foreground */
+#define TUI_FG_BRIGHT  TUI_FG_16(8)   /**< Combine with another of the foreground colors above, in the same call, to brighten it. Not supported on all terminals. */
+
+#define TUI_BG_DEFAULT (0)            /**< Default background color */
+#define TUI_BG_BLACK   TUI_BG_16(0)   /**< Black background */
+#define TUI_BG_RED     TUI_BG_16(1)   /**< Red background */
+#define TUI_BG_GREEN   TUI_BG_16(2)   /**< Green background */
+#define TUI_BG_YELLOW  TUI_BG_16(3)   /**< Yellow background */
+#define TUI_BG_BLUE    TUI_BG_16(4)   /**< Blue background */
+#define TUI_BG_MAGENTA TUI_BG_16(5)   /**< Magenta background */
+#define TUI_BG_CYAN    TUI_BG_16(6)   /**< Cyan background */
+#define TUI_BG_WHITE   TUI_BG_16(7)   /**< White background */
+#define TUI_BG_BRIGHT  TUI_BG_16(8)   /**< Combine with another of the background colors above, in the same call, to brighten it. Not supported on all terminals. */
 
 /**
  * Turns terminal attributes on.
@@ -49,9 +84,10 @@
  * ```C
  * tui_attron(TUI_UNDERLINE | TUI_FG_RED | TUI_FG_BRIGHT);
  * ```
- * This command would apply an underline and a bright red foreground color to all text printed afterwards.
+ * This command would apply an underline and a bright red foreground color to all text printed afterwards.<br>
+ * Flags are added to the current ones, and a color replaces the current color.
  */
-void TUI_API tui_attron(uint_fast32_t attr);
+void TUI_API tui_attron(tui_style attr);
 
 /**
  * Turns terminal attributes off.
@@ -64,12 +100,10 @@ void TUI_API tui_attron(uint_fast32_t attr);
  * tui_attroff(TUI_UNDERLINE | TUI_FG_RED);
  * ```
  * This command would remove any underlining and set the color back to default for all text printed afterwards.<br>
- * If said attributes are not already on, this function does nothing.
- *
- * @bug tui_attroff(TUI_FG_BRIGHT) does not revert to normal version of color.
- * @bug tui_attroff(TUI_BOLD) does not work on xterm.
+ * If said attributes are not already on, this function does nothing.<br>
+ * Turning off TUI_FG_BRIGHT or TUI_BG_BRIGHT by itself drops back to the normal version of the color.
  */
-void TUI_API tui_attroff(uint_fast32_t attr);
+void TUI_API tui_attroff(tui_style attr);
 
 /**
  * Turns all terminal attributes off.
@@ -77,8 +111,19 @@ void TUI_API tui_attroff(uint_fast32_t attr);
  */
 void TUI_API tui_attrclear(void);
 
+/**
+ * Replaces the current terminal attributes.
+ * The effects are only applied to text printed after this function is called.<br>
+ * If the given attributes are already the current ones, this function does nothing.
+ * @see tui_attron()
+ *
+ * @param attr The attributes that should be on. All others are turned off.
+ */
+void TUI_API tui_attrset(tui_style attr);
+
 /**
  * Gets the number of columns (width) of the current terminal window.
+ * The size is cached, so this is cheap to call repeatedly.
  *
  * @return The width of the current terminal window in columns.
  */
@@ -86,11 +131,29 @@ int TUI_API tui_getcols(void);
 
 /**
  * Gets the number of rows (height) of the current terminal window.
+ * The size is cached, so this is cheap to call repeatedly.
  *
  * @return The height of the current terminal window in rows.
  */
 int TUI_API tui_getrows(void);
 
+/**
+ * Checks if the terminal was resized since the last call.
+ * If so, tui_getrows() and tui_getcols() return the new size.
+ *
+ * @return 1 if the terminal was resized, 0 if not.
+ */
+int TUI_API tui_resized(void);
+
+/**
+ * Gets a file descriptor that becomes readable when the terminal is resized.
+ * This allows waiting for a resize with poll() or similar alongside other file descriptors.<br>
+ * Call tui_resized() once it is readable to acknowledge the resize.
+ *
+ * @return The file descriptor, or -1 if this is not supported.
+ */
+int TUI_API tui_resize_fd(void);
+
 /**
  * Shows or hides the terminal cursor.
  *
@@ -133,38 +196,231 @@ void TUI_API tui_setcursorpos(int row, int col);
  */
 void TUI_API tui_movecursorpos(int row_delta, int col_delta);
 
+/**
+ * Moves the cursor from where it is known to be to another position.
+ * Of the ways the terminal understands, the one that takes the fewest bytes is sent:
+ * an absolute position, relative movement, a carriage return and line feeds, or a combination of them.
+ *
+ * @param from_row The row the cursor is on.<br>
+ * If a negative value is passed, the cursor's position is unknown and the move is absolute.
+ * @param from_col The column the cursor is on.
+ * @param to_row The row to move the cursor to.
+ * @param to_col The column to move the cursor to.
+ */
+void TUI_API tui_movecursor(int from_row, int from_col, int to_row, int to_col);
+
+/**
+ * Gets how many bytes tui_movecursor() would send for a move.
+ * This lets a caller decide whether rewriting the cells in between is cheaper than moving over them.
+ *
+ * @return The number of bytes, or 0 if the backend doesn't move the cursor by sending bytes.
+ */
+int TUI_API tui_movecost(int from_row, int from_col, int to_row, int to_col);
+
 /**
  * Clears the screen.
  */
 void TUI_API tui_clear(void);
 
-#define KEY_UP        (-2)     /**< Up arrow */
-#define KEY_DOWN      (-3)     /**< Down arrow */
-#define KEY_RIGHT     (-4)     /**< Right arrow */
-#define KEY_LEFT      (-5)     /**< Left arrow */
+/**
+ * Moves rows of the screen up or down without sending their contents again.
+ * The rows that come in are blank, in the background color that is currently set.<br>
+ * Afterwards the cursor position is unknown, so set it before writing.
+ *
+ * @param top The first row that moves.
+ * @param bot The last row that moves, inclusive.
+ * @param n How many rows to move them up by.<br>
+ * If a negative value is passed, they move down instead.
+ *
+ * @return 0 on success, or negative if the terminal cannot scroll part of the screen.
+ */
+int TUI_API tui_scroll(int top, int bot, int n);
+
+/**
+ * Starts or ends a frame that the terminal should show all at once (synchronized output, DECSET 2026).
+ * Between the two the terminal holds off repainting, so a frame that arrives in several reads never shows half-drawn.<br>
+ * Whether the terminal supports it is asked once tui_input_begin() starts input.
+ * Until it answers, and on terminals that don't, nothing is sent and frames are shown as they arrive.
+ *
+ * @param begin Nonzero to start a frame, zero to end it.
+ *
+ * @return 0 if the frame is bracketed, negative if synchronized output is not supported.
+ */
+int TUI_API tui_sync(int begin);
+
+/**
+ * Writes text to the terminal.
+ * Like every other output function here, the text is buffered until tui_flush() is called.
+ * @see tui_flush()
+ *
+ * @param buf The bytes to write. This does not need to be null-terminated.
+ * @param len The number of bytes to write.
+ *
+ * @return 0 on success, negative on failure.
+ */
+int TUI_API tui_write(const char* buf, size_t len);
+
+/**
+ * Sends everything written since the last call to the terminal.
+ * This should be called once per frame.<br>
+ * Text printed with printf() or similar is not part of the buffer.
+ * If that is mixed with the functions here, call tui_flush() before printing.
+ *
+ * @return 0 on success, negative on failure.
+ */
+int TUI_API tui_flush(void);
+
+#define KEY_UP        (0x101)  /**< Up arrow */
+#define KEY_DOWN      (0x102)  /**< Down arrow */
+#define KEY_RIGHT     (0x103)  /**< Right arrow */
+#define KEY_LEFT      (0x104)  /**< Left arrow */
+#define KEY_HOME      (0x105)  /**< Home */
+#define KEY_END       (0x106)  /**< End */
+#define KEY_PGUP      (0x107)  /**< Page up */
+#define KEY_PGDOWN    (0x108)  /**< Page down */
+#define KEY_INSERT    (0x109)  /**< Insert */
+#define KEY_DELETE    (0x10A)  /**< Delete (not backspace) */
+#define KEY_F(n)      (0x110 + (n)) /**< Function key n, from 1 to 20 */
 #define KEY_ENTER     ('\n')   /**< Enter key */
 #define KEY_BACKSPACE ('\x7F') /**< Backspace */
+#define KEY_ESCAPE    ('\033') /**< Escape key */
+
+#define KEY_MOD_SHIFT (1 << 12) /**< Combined with a key if shift was held. Not reported for printable characters. */
+#define KEY_MOD_ALT   (1 << 13) /**< Combined with a key if alt was held. */
+#define KEY_MOD_CTRL  (1 << 14) /**< Combined with a key if ctrl was held. Not reported for printable characters. */
+#define KEY_MOD_MASK  (KEY_MOD_SHIFT | KEY_MOD_ALT | KEY_MOD_CTRL) /**< All modifier flags. Use key & ~KEY_MOD_MASK to get the key itself. */
+
 /**
- * Gets a keypress from the terminal.
- * This function can read arrow keys, enter, and backspace in addition to the regular keys.<br>
+ * Sets how long to wait for the rest of an escape sequence after an ESC byte.
+ * If nothing arrives in that time, the ESC is reported as KEY_ESCAPE.<br>
+ * The default is 50 milliseconds.
  *
- * @pre Before use, stdin must be emptied after any previous usage of stdin.<br>
- * This can be done with the following command:<br>
- * ```C
- * #include <stdio.h>
+ * @param ms The timeout in milliseconds.
+ */
+void TUI_API tui_set_esc_timeout(int ms);
+/**
+ * Starts an input session.
+ * The terminal is switched to raw mode once for the whole session instead of once per key,
+ * and keypresses are no longer echoed.<br>
+ * The first session on a terminal also asks it whether it supports synchronized output (see tui_sync()).
+ * The answer is read along with the keys.
+ * The session tui_getch() starts on its own does not ask, because it ends before the answer may arrive.<br>
+ * Calling this while a session is already active does nothing.
+ * @see tui_input_end()
+ * @see tui_getkeys()
  *
- * int c;
- * while ((c = getchar()) != '\n' && c != EOF);
- * ```
+ * @return 0 on success, negative on failure.
+ */
+int TUI_API tui_input_begin(void);
+
+/**
+ * Ends an input session, restoring the terminal to the mode it was in before tui_input_begin().
+ * Keys that were read but not returned yet are kept for the next session.
+ *
+ * @return 0 on success, negative on failure.
+ */
+int TUI_API tui_input_end(void);
+
+/**
+ * Gets every keypress that is available without blocking.
+ * This must be called during an input session.
+ * @see tui_input_begin()
+ *
+ * @param keys The buffer to store the keys in.<br>
+ * Each key is the same as what tui_getch() would return.
+ * @param n The maximum number of keys to store.
  *
- * @return A character corresponding to the character read.
+ * @return The number of keys stored, which may be 0.<br>
+ * Negative if no session is active, on a read error, or once the input has ended.
+ */
+int TUI_API tui_getkeys(int* keys, size_t n);
+
+/**
+ * Gets how long to wait for more input before calling tui_getkeys() again.
+ * This is needed when waiting for input with poll() or similar,
+ * because a partial escape sequence turns into KEY_ESCAPE once nothing else arrives in time.
+ * @see tui_set_esc_timeout()
+ *
+ * @return The timeout in milliseconds, or -1 if there is no need to wake up until more input arrives.
+ */
+int TUI_API tui_input_timeout(void);
+
+/**
+ * Gets a keypress from the terminal, waiting until one is available.
+ * This function can read arrow keys, navigation keys, function keys, enter, and backspace in addition to the regular keys,
+ * along with the modifiers held for them.<br>
+ * If no input session is active, one is started for the duration of this call.
+ *
+ * @return A character corresponding to the character read, or EOF if the input has ended.
  * @see KEY_UP
  * @see KEY_DOWN
  * @see KEY_RIGHT
  * @see KEY_LEFT
+ * @see KEY_HOME
+ * @see KEY_F
  * @see KEY_ENTER
  * @see KEY_BACKSPACE
+ * @see KEY_ESCAPE
+ * @see KEY_MOD_MASK
  */
 int TUI_API tui_getch(void);
 
+/**
+ * @brief The operations a backend provides.
+ * Every function above forwards to the current backend, so anything that renders or reads keys
+ * can be pointed at something other than the terminal, such as the headless backend in headless.h.<br>
+ * Each member has the same contract as the function of the same name.
+ * attrget returns the attributes that are currently on, which tui_attron() and tui_attroff() build on.
+ */
+typedef struct tui_backend{
+	tui_style (*attrget)(void);
+	void (*attrset)(tui_style attr);
+	void (*attrclear)(void);
+	int (*getcols)(void);
+	int (*getrows)(void);
+	int (*resized)(void);
+	int (*resize_fd)(void);
+	void (*showcursor)(int enable);
+	int (*setecho)(int enable);
+	void (*setcursorpos)(int row, int col);
+	void (*movecursorpos)(int row_delta, int col_delta);
+	void (*movecursor)(int from_row, int from_col, int to_row, int to_col);
+	int (*movecost)(int from_row, int from_col, int to_row, int to_col);
+	void (*clear)(void);
+	int (*scroll)(int top, int bot, int n);
+	int (*sync)(int begin);
+	int (*write)(const char* buf, size_t len);
+	int (*flush)(void);
+	void (*set_esc_timeout)(int ms);
+	int (*input_begin)(void);
+	int (*input_end)(void);
+	int (*getkeys)(int* keys, size_t n);
+	int (*input_timeout)(void);
+	int (*getch)(void);
+}tui_backend;
+
+/**
+ * Gets the backend that talks to the real terminal.
+ * This is the current backend until tui_set_backend() is called.
+ *
+ * @return The terminal backend.
+ */
+const tui_backend* TUI_API tui_terminal_backend(void);
+
+/**
+ * Gets the backend that every function here currently forwards to.
+ *
+ * @return The current backend.
+ */
+const tui_backend* TUI_API tui_get_backend(void);
+
+/**
+ * Replaces the backend that every function here forwards to.
+ * Output buffered by the previous backend is flushed first.<br>
+ * The next tui_show() repaints the whole screen, since the new backend's contents are unknown.
+ *
+ * @param backend The new backend, or NULL for the terminal backend.
+ */
+void TUI_API tui_set_backend(const tui_backend* backend);
+
 #endif
@@ -0,0 +1,464 @@
+/** @file backend/ansi.c
+ * @brief Encodes output as ANSI escape sequences, buffered until the frame is flushed.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ * Every backend that talks to something that understands VT100 sequences shares this encoder,
+ * so a real terminal and the headless backend receive exactly the same bytes.
+ */
+
+#include "../backend.h"
+#include "../stats.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Where a flushed frame is sent.
+ *
+ * @return 0 on success, negative on failure.
+ */
+typedef int (*tui_ansi_sink)(const char* buf, size_t len);
+
+/**
+ * @brief The state of one encoder.
+ */
+typedef struct tui_ansi{
+	/**
+	 * @brief Everything written since the last flush.
+	 * The whole frame leaves in a single call to the sink instead of one per escape sequence.
+	 */
+	char* data;
+	size_t len;
+	size_t cap;
+
+	/**
+	 * @brief The style the receiving end currently has.
+	 */
+	tui_style attr_cur;
+
+	tui_ansi_sink sink;
+}tui_ansi;
+
+static void __tui_ansi_flush_atexit(void){
+	tui_flush();
+}
+
+static int __tui_ansi_flush(tui_ansi* a){
+	int ret;
+
+	if (a->len == 0){
+		return 0;
+	}
+	ret = a->sink(a->data, a->len);
+	a->len = 0;
+	return ret;
+}
+
+static bool __tui_ansi_reserve(tui_ansi* a, size_t n){
+	static bool atexit_registered = false;
+	char* tmp;
+	size_t cap;
+
+	if (a->cap - a->len >= n){
+		return true;
+	}
+
+	cap = a->cap ? a->cap : 4096;
+	while (cap - a->len < n){
+		cap *= 2;
+	}
+	tmp = realloc(a->data, cap);
+	if (!tmp){
+		return false;
+	}
+	a->data = tmp;
+	a->cap = cap;
+
+	// don't lose a frame that was never flushed
+	if (!atexit_registered){
+		atexit(__tui_ansi_flush_atexit);
+		atexit_registered = true;
+	}
+	return true;
+}
+
+static void __tui_ansi_write(tui_ansi* a, const char* buf, size_t len){
+	if (!__tui_ansi_reserve(a, len)){
+		// out of memory. send what we have so far and the new data directly
+		__tui_ansi_flush(a);
+		a->sink(buf, len);
+		return;
+	}
+	memcpy(a->data + a->len, buf, len);
+	a->len += len;
+}
+
+static void __tui_ansi_str(tui_ansi* a, const char* str){
+	__tui_ansi_write(a, str, strlen(str));
+}
+
+static void TUI_PRINTF_LIKE(1) __tui_ansi_printf(tui_ansi* a, const char* format, ...){
+	va_list ap;
+	int n;
+
+	// escape sequences are short, so try to format straight into the buffer first
+	if (!__tui_ansi_reserve(a, 32)){
+		return;
+	}
+	va_start(ap, format);
+	n = vsnprintf(a->data + a->len, a->cap - a->len, format, ap);
+	va_end(ap);
+	if (n < 0){
+		return;
+	}
+
+	if ((size_t)n >= a->cap - a->len){
+		if (!__tui_ansi_reserve(a, (size_t)n + 1)){
+			return;
+		}
+		va_start(ap, format);
+		vsnprintf(a->data + a->len, a->cap - a->len, format, ap);
+		va_end(ap);
+	}
+	a->len += n;
+}
+
+/* the longest transition is a reset, 4 flags and two 24-bit colors (5 parameters each) */
+#define TUI_SGR_MAX_CODES (15)
+
+/**
+ * @brief The SGR parameters that turn each flag bit on and off.
+ * Bits without parameters are 0 and never emitted.
+ */
+static const struct tui_sgr_flag{
+	unsigned char on;
+	unsigned char off;
+}sgr_flags[8] = {
+	{ 1, 22 }, /* TUI_BOLD */
+	{ 4, 24 }, /* TUI_UNDERLINE */
+	{ 5, 25 }, /* TUI_BLINK */
+	{ 7, 27 }  /* TUI_INVERT */
+};
+
+/**
+ * Gets the SGR parameters that select a color.
+ *
+ * @param mode How the color is given (TUI_COLOR_*).
+ * @param value The color index or 0xRRGGBB.
+ * @param base 30 for the foreground, 40 for the background.
+ *
+ * @return The number of parameters written to codes.
+ */
+static size_t __tui_sgr_color(int mode, uint32_t value, int base, int* codes){
+	switch (mode){
+	case TUI_COLOR_16:
+		codes[0] = value < 8 ? base + (int)value : base + 60 + (int)value - 8;
+		return 1;
+	case TUI_COLOR_256:
+		codes[0] = base + 8;
+		codes[1] = 5;
+		codes[2] = (int)value;
+		return 3;
+	case TUI_COLOR_RGB:
+		codes[0] = base + 8;
+		codes[1] = 2;
+		codes[2] = (int)(value >> 16);
+		codes[3] = (int)(value >> 8 & 0xFF);
+		codes[4] = (int)(value & 0xFF);
+		return 5;
+	default:
+		codes[0] = base + 9;
+		return 1;
+	}
+}
+
+/**
+ * Gets the SGR parameters that change the terminal from one style to another.
+ *
+ * @return The number of parameters written to codes.
+ */
+static size_t __tui_sgr_codes(tui_style prev, tui_style next, int* codes){
+	unsigned flags = (unsigned)((prev ^ next) & TUI_STYLE_FLAGS);
+	size_t n = 0;
+
+	for (int bit = 0; flags; ++bit, flags >>= 1){
+		int code = next & (1u << bit) ? sgr_flags[bit].on : sgr_flags[bit].off;
+		if ((flags & 1) && code != 0){
+			codes[n++] = code;
+		}
+	}
+	if ((prev ^ next) & TUI_STYLE_FG){
+		n += __tui_sgr_color(TUI_STYLE_FG_MODE(next), TUI_STYLE_FG_VALUE(next), 30, codes + n);
+	}
+	if ((prev ^ next) & TUI_STYLE_BG){
+		n += __tui_sgr_color(TUI_STYLE_BG_MODE(next), TUI_STYLE_BG_VALUE(next), 40, codes + n);
+	}
+	return n;
+}
+
+/**
+ * Formats SGR parameters as a single "\033[a;b;cm" sequence.
+ *
+ * @return The length of the sequence.
+ */
+static size_t __tui_sgr_format(const int* codes, size_t n, char* buf){
+	size_t len = 0;
+
+	buf[len++] = '\033';
+	buf[len++] = '[';
+	for (size_t i = 0; i < n; ++i){
+		int c = codes[i];
+		if (i > 0){
+			buf[len++] = ';';
+		}
+		if (c >= 100){
+			buf[len++] = '0' + c / 100;
+		}
+		if (c >= 10){
+			buf[len++] = '0' + c / 10 % 10;
+		}
+		buf[len++] = '0' + c % 10;
+	}
+	buf[len++] = 'm';
+	return len;
+}
+
+/**
+ * Emits the shortest sequence that changes the terminal's style from prev to next.
+ * This is either the parameters that changed, or a reset followed by every part of next.
+ */
+static void __tui_sgr_transition(tui_ansi* a, tui_style prev, tui_style next){
+	int codes[TUI_SGR_MAX_CODES];
+	char diff[TUI_SGR_MAX_CODES * 4 + 3];
+	char reset[TUI_SGR_MAX_CODES * 4 + 3];
+	size_t diff_len;
+	size_t reset_len;
+	size_t n;
+
+	n = __tui_sgr_codes(prev, next, codes);
+	if (n == 0){
+		return;
+	}
+	diff_len = __tui_sgr_format(codes, n, diff);
+
+	codes[0] = 0;
+	n = __tui_sgr_codes(TUI_NORMAL, next, codes + 1) + 1;
+	reset_len = __tui_sgr_format(codes, n, reset);
+
+	TUI_STAT_ADD(sgr, 1);
+	if (reset_len < diff_len){
+		__tui_ansi_write(a, reset, reset_len);
+	}
+	else{
+		__tui_ansi_write(a, diff, diff_len);
+	}
+}
+
+static void __tui_ansi_attrset(tui_ansi* a, tui_style attr){
+	if (attr == a->attr_cur){
+		return;
+	}
+	__tui_sgr_transition(a, a->attr_cur, attr);
+	a->attr_cur = attr;
+}
+
+static void __tui_ansi_attrclear(tui_ansi* a){
+	__tui_ansi_str(a, "\033[0m");
+	a->attr_cur = 0;
+	TUI_STAT_ADD(sgr, 1);
+}
+
+static void __tui_ansi_showcursor(tui_ansi* a, int enable){
+	if (enable){
+		__tui_ansi_str(a, "\033[?25h");
+	}
+	else{
+		__tui_ansi_str(a, "\033[?25l");
+	}
+}
+
+/* long enough for any cursor movement __tui_move_seq() picks */
+#define TUI_MOVE_MAX (32)
+
+/* moving down with line feeds is only tried for this many rows, since "\033[nB" is never longer than 3 + digits */
+#define TUI_MOVE_MAX_LF (4)
+
+static size_t __tui_format_int(char* buf, int n){
+	char tmp[12];
+	size_t len = 0;
+
+	do{
+		tmp[len++] = '0' + n % 10;
+		n /= 10;
+	}while (n > 0);
+	for (size_t i = 0; i < len; ++i){
+		buf[i] = tmp[len - 1 - i];
+	}
+	return len;
+}
+
+/**
+ * Formats "\033[nX", leaving out n if it is 1 since that is the default.
+ */
+static size_t __tui_csi_format(char* buf, int n, char final){
+	size_t len = 0;
+
+	buf[len++] = '\033';
+	buf[len++] = '[';
+	if (n != 1){
+		len += __tui_format_int(buf + len, n);
+	}
+	buf[len++] = final;
+	return len;
+}
+
+/**
+ * Formats an absolute move (CUP), leaving out parameters that are 1.
+ */
+static size_t __tui_cup_format(char* buf, int row, int col){
+	size_t len = 0;
+
+	buf[len++] = '\033';
+	buf[len++] = '[';
+	if (row > 0){
+		len += __tui_format_int(buf + len, row + 1);
+	}
+	if (col > 0){
+		buf[len++] = ';';
+		len += __tui_format_int(buf + len, col + 1);
+	}
+	buf[len++] = 'H';
+	return len;
+}
+
+/**
+ * Formats the shortest way to move horizontally within a row: a carriage return, CUF/CUB, or CHA.
+ */
+static size_t __tui_move_col_format(char* buf, int from, int to){
+	char alt[TUI_MOVE_MAX];
+	size_t len;
+	size_t n;
+
+	if (from == to){
+		return 0;
+	}
+	if (to == 0){
+		buf[0] = '\r';
+		return 1;
+	}
+	len = __tui_csi_format(buf, to > from ? to - from : from - to, to > from ? 'C' : 'D');
+	n = __tui_csi_format(alt, to + 1, 'G');
+	if (n < len){
+		memcpy(buf, alt, n);
+		len = n;
+	}
+	return len;
+}
+
+/**
+ * Formats the shortest sequence that moves the cursor from one position to another.
+ * The candidates are an absolute move (CUP), a relative move (CUU/CUD followed by the best horizontal move),
+ * and a carriage return followed by line feeds.<br>
+ * Line feeds only follow a carriage return, since a terminal that translates them to CR LF would otherwise move the column.
+ *
+ * @param from_row The row the cursor is on, or negative if it is unknown.
+ *
+ * @return The length of the sequence, at most TUI_MOVE_MAX.
+ */
+static size_t __tui_move_seq(char* buf, int from_row, int from_col, int to_row, int to_col){
+	char alt[TUI_MOVE_MAX];
+	size_t len;
+	size_t n = 0;
+
+	len = __tui_cup_format(buf, to_row, to_col);
+	if (from_row < 0){
+		return len;
+	}
+
+	if (to_row != from_row){
+		n = __tui_csi_format(alt, to_row > from_row ? to_row - from_row : from_row - to_row, to_row > from_row ? 'B' : 'A');
+	}
+	n += __tui_move_col_format(alt + n, from_col, to_col);
+	if (n < len){
+		memcpy(buf, alt, n);
+		len = n;
+	}
+
+	if (to_row > from_row && to_row - from_row <= TUI_MOVE_MAX_LF){
+		n = 0;
+		alt[n++] = '\r';
+		for (int i = from_row; i < to_row; ++i){
+			alt[n++] = '\n';
+		}
+		n += __tui_move_col_format(alt + n, 0, to_col);
+		if (n < len){
+			memcpy(buf, alt, n);
+			len = n;
+		}
+	}
+	return len;
+}
+
+static void __tui_ansi_setcursorpos(tui_ansi* a, int row, int col){
+	char buf[TUI_MOVE_MAX];
+
+	TUI_STAT_ADD(cursor_moves, 1);
+	__tui_ansi_write(a, buf, __tui_cup_format(buf, row, col));
+}
+
+static void __tui_ansi_movecursorpos(tui_ansi* a, int row_delta, int col_delta){
+	char buf[TUI_MOVE_MAX * 2];
+	size_t len = 0;
+
+	TUI_STAT_ADD(cursor_moves, 1);
+	if (row_delta != 0){
+		len += __tui_csi_format(buf + len, row_delta > 0 ? row_delta : -row_delta, row_delta > 0 ? 'B' : 'A');
+	}
+	if (col_delta != 0){
+		len += __tui_csi_format(buf + len, col_delta > 0 ? col_delta : -col_delta, col_delta > 0 ? 'C' : 'D');
+	}
+	__tui_ansi_write(a, buf, len);
+}
+
+static void __tui_ansi_movecursor(tui_ansi* a, int from_row, int from_col, int to_row, int to_col){
+	char buf[TUI_MOVE_MAX];
+
+	TUI_STAT_ADD(cursor_moves, 1);
+	__tui_ansi_write(a, buf, __tui_move_seq(buf, from_row, from_col, to_row, to_col));
+}
+
+static int __tui_ansi_movecost(int from_row, int from_col, int to_row, int to_col){
+	char buf[TUI_MOVE_MAX];
+
+	return (int)__tui_move_seq(buf, from_row, from_col, to_row, to_col);
+}
+
+static void __tui_ansi_clear(tui_ansi* a){
+	__tui_ansi_str(a, "\033[2J\033[1;1H");
+}
+
+/**
+ * Scrolls with a temporary scrolling region (DECSTBM) and SU/SD.
+ * Resetting the region afterwards also homes the cursor.
+ */
+static int __tui_ansi_scroll(tui_ansi* a, int top, int bot, int n){
+	if (n == 0){
+		return 0;
+	}
+	__tui_ansi_printf(a, "\033[%d;%dr\033[%d%c\033[r", top + 1, bot + 1, n > 0 ? n : -n, n > 0 ? 'S' : 'T');
+	return 0;
+}
+
+/**
+ * Starts or ends a synchronized update (DECSET/DECRST 2026).
+ * Terminals that don't know the mode ignore it.
+ */
+static void __tui_ansi_sync(tui_ansi* a, int begin){
+	__tui_ansi_str(a, begin ? "\033[?2026h" : "\033[?2026l");
+}
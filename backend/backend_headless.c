@@ -0,0 +1,857 @@
+/** @file backend/backend_headless.c
+ * @brief A backend that interprets its own output into a virtual screen.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "../backend.h"
+#include "../framebuffer.h"
+#include "../headless.h"
+#include "../input.h"
+#include "../stats.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TUI_HL_GROUND (0) /**< Printing text */
+#define TUI_HL_ESC    (1) /**< Read ESC */
+#define TUI_HL_CSI    (2) /**< Read ESC [ */
+
+#define TUI_HL_PARAMS_MAX (16)
+#define TUI_HL_PARAM_MAX  (9999)
+
+/**
+ * @brief The virtual terminal.
+ */
+static struct tui_headless{
+	int rows;
+	int cols;
+
+	/**
+	 * @brief rows * cols cells, row by row.
+	 */
+	tui_cell* grid;
+
+	int row;
+	int col;
+
+	/**
+	 * @brief True after a glyph was printed in the last column.
+	 * Like a real terminal, the line only wraps once the next glyph arrives.
+	 */
+	bool wrap_pending;
+	bool cursor_visible;
+	bool resized;
+
+	/**
+	 * @brief True between DECSET 2026 and DECRST 2026 (synchronized output).
+	 */
+	bool synchronized;
+
+	/**
+	 * @brief The style selected by the last SGR sequences.
+	 */
+	tui_style attr;
+
+	/**
+	 * @brief The scrolling region set with DECSTBM, inclusive.
+	 */
+	int top;
+	int bot;
+
+	struct tui_hl_saved{
+		int row;
+		int col;
+		tui_style attr;
+	}saved;
+
+	/**
+	 * @brief The escape sequence being parsed.
+	 */
+	int state;
+	int params[TUI_HL_PARAMS_MAX];
+	int n_params;
+	char priv;
+	char inter;
+
+	/**
+	 * @brief The UTF-8 glyph being read.
+	 */
+	char glyph[4];
+	int glyph_len;
+	int glyph_need;
+
+	/**
+	 * @brief Keys decoded from tui_headless_input() that were not read yet.
+	 */
+	struct tui_hl_keys{
+		int* data;
+		size_t head;
+		size_t len;
+		size_t cap;
+	}keys;
+	tui_keydecoder kd;
+}hl = { .cursor_visible = true };
+
+static TUI_INLINE tui_cell* __tui_hl_at(int row, int col){
+	return &hl.grid[(size_t)row * hl.cols + col];
+}
+
+/**
+ * Gets the cell that erased cells become.
+ * Erasing fills with the current background color, as xterm does.
+ */
+static tui_cell __tui_hl_blank(void){
+	tui_cell c = { { ' ', '\0', '\0', '\0' }, hl.attr & TUI_STYLE_BG };
+	return c;
+}
+
+static void __tui_hl_erase(int row, int col1, int col2){
+	tui_cell blank = __tui_hl_blank();
+
+	for (int col = col1; col <= col2; ++col){
+		*__tui_hl_at(row, col) = blank;
+	}
+}
+
+static int __tui_hl_alloc(int rows, int cols){
+	tui_cell* grid;
+	tui_cell blank = { { ' ', '\0', '\0', '\0' }, TUI_NORMAL };
+
+	if (rows <= 0 || cols <= 0){
+		return -1;
+	}
+	grid = malloc((size_t)rows * (size_t)cols * sizeof(*grid));
+	if (!grid){
+		return -1;
+	}
+	for (int row = 0; row < rows; ++row){
+		for (int col = 0; col < cols; ++col){
+			tui_cell* c = &grid[(size_t)row * cols + col];
+			*c = row < hl.rows && col < hl.cols ? *__tui_hl_at(row, col) : blank;
+		}
+	}
+
+	free(hl.grid);
+	hl.grid = grid;
+	hl.rows = rows;
+	hl.cols = cols;
+	hl.top = 0;
+	hl.bot = rows - 1;
+	hl.row = hl.row < rows ? hl.row : rows - 1;
+	hl.col = hl.col < cols ? hl.col : cols - 1;
+	hl.wrap_pending = false;
+	return 0;
+}
+
+static bool __tui_hl_init(void){
+	return hl.grid || __tui_hl_alloc(24, 80) == 0;
+}
+
+/**
+ * Moves rows top..bot of the scrolling region up by n, blanking the rows that come in at the bottom.
+ * A negative n scrolls down instead.
+ */
+static void __tui_hl_scroll_rows(int top, int bot, int n){
+	int height = bot - top + 1;
+	int count = n < 0 ? -n : n;
+
+	if (count > height){
+		count = height;
+	}
+	if (n > 0){
+		memmove(__tui_hl_at(top, 0), __tui_hl_at(top + count, 0), (size_t)(height - count) * hl.cols * sizeof(tui_cell));
+		for (int row = bot - count + 1; row <= bot; ++row){
+			__tui_hl_erase(row, 0, hl.cols - 1);
+		}
+	}
+	else if (n < 0){
+		memmove(__tui_hl_at(top + count, 0), __tui_hl_at(top, 0), (size_t)(height - count) * hl.cols * sizeof(tui_cell));
+		for (int row = top; row < top + count; ++row){
+			__tui_hl_erase(row, 0, hl.cols - 1);
+		}
+	}
+}
+
+static void __tui_hl_linefeed(void){
+	if (hl.row == hl.bot){
+		__tui_hl_scroll_rows(hl.top, hl.bot, 1);
+	}
+	else if (hl.row < hl.rows - 1){
+		hl.row++;
+	}
+}
+
+static void __tui_hl_reverse_linefeed(void){
+	if (hl.row == hl.top){
+		__tui_hl_scroll_rows(hl.top, hl.bot, -1);
+	}
+	else if (hl.row > 0){
+		hl.row--;
+	}
+}
+
+static void __tui_hl_goto(int row, int col){
+	hl.row = row < 0 ? 0 : row >= hl.rows ? hl.rows - 1 : row;
+	hl.col = col < 0 ? 0 : col >= hl.cols ? hl.cols - 1 : col;
+	hl.wrap_pending = false;
+}
+
+static void __tui_hl_print(void){
+	tui_cell* c;
+
+	if (hl.wrap_pending){
+		hl.col = 0;
+		__tui_hl_linefeed();
+		hl.wrap_pending = false;
+	}
+	c = __tui_hl_at(hl.row, hl.col);
+	memset(c->glyph, '\0', sizeof(c->glyph));
+	memcpy(c->glyph, hl.glyph, (size_t)hl.glyph_len);
+	c->attr = hl.attr;
+
+	if (hl.col == hl.cols - 1){
+		hl.wrap_pending = true;
+	}
+	else{
+		hl.col++;
+	}
+}
+
+/**
+ * Gets the nth parameter of the current sequence, or def if it was left out or 0.
+ */
+static int __tui_hl_param(int n, int def){
+	return n < hl.n_params && hl.params[n] > 0 ? hl.params[n] : def;
+}
+
+/**
+ * Reads the color of an extended color sequence ("38;5;n" or "38;2;r;g;b") starting at parameter i.
+ *
+ * @param i The index of the 38 or 48. Advanced past the color's parameters.
+ * @param n The number of parameters.
+ * @param bg Nonzero for a background color.
+ *
+ * @return The color, or 0 if the sequence is malformed.
+ */
+static tui_style __tui_hl_sgr_ext(int* i, int n, int bg){
+	tui_style color = 0;
+
+	if (*i + 2 < n && hl.params[*i + 1] == 5){
+		color = bg ? TUI_BG_256(hl.params[*i + 2]) : TUI_FG_256(hl.params[*i + 2]);
+		*i += 2;
+	}
+	else if (*i + 4 < n && hl.params[*i + 1] == 2){
+		int r = hl.params[*i + 2];
+		int g = hl.params[*i + 3];
+		int b = hl.params[*i + 4];
+		color = bg ? TUI_BG_RGB(r, g, b) : TUI_FG_RGB(r, g, b);
+		*i += 4;
+	}
+	return color;
+}
+
+static void __tui_hl_sgr(void){
+	// "ESC [ m" is the same as "ESC [ 0 m"
+	int n = hl.n_params > 0 ? hl.n_params : 1;
+
+	for (int i = 0; i < n; ++i){
+		int p = i < hl.n_params ? hl.params[i] : 0;
+
+		switch (p){
+		case 0:  hl.attr = TUI_NORMAL;      break;
+		case 1:  hl.attr |= TUI_BOLD;       break;
+		case 4:  hl.attr |= TUI_UNDERLINE;  break;
+		case 5:  hl.attr |= TUI_BLINK;      break;
+		case 7:  hl.attr |= TUI_INVERT;     break;
+		case 22: hl.attr &= ~(tui_style)TUI_BOLD;      break;
+		case 24: hl.attr &= ~(tui_style)TUI_UNDERLINE; break;
+		case 25: hl.attr &= ~(tui_style)TUI_BLINK;     break;
+		case 27: hl.attr &= ~(tui_style)TUI_INVERT;    break;
+		case 39: hl.attr &= ~TUI_STYLE_FG; break;
+		case 49: hl.attr &= ~TUI_STYLE_BG; break;
+		case 38:
+			hl.attr = (hl.attr & ~TUI_STYLE_FG) | __tui_hl_sgr_ext(&i, n, 0);
+			break;
+		case 48:
+			hl.attr = (hl.attr & ~TUI_STYLE_BG) | __tui_hl_sgr_ext(&i, n, 1);
+			break;
+		default:
+			if (p >= 30 && p <= 37){
+				hl.attr = (hl.attr & ~TUI_STYLE_FG) | TUI_FG_16(p - 30);
+			}
+			else if (p >= 90 && p <= 97){
+				hl.attr = (hl.attr & ~TUI_STYLE_FG) | TUI_FG_16(p - 90 + 8);
+			}
+			else if (p >= 40 && p <= 47){
+				hl.attr = (hl.attr & ~TUI_STYLE_BG) | TUI_BG_16(p - 40);
+			}
+			else if (p >= 100 && p <= 107){
+				hl.attr = (hl.attr & ~TUI_STYLE_BG) | TUI_BG_16(p - 100 + 8);
+			}
+			break;
+		}
+	}
+}
+
+static void __tui_hl_reply(const char* str){
+	tui_headless_input(str, strlen(str));
+}
+
+/**
+ * Handles "ESC [ ? ... X" sequences.
+ */
+static void __tui_hl_csi_private(char final){
+	int mode = __tui_hl_param(0, 0);
+	char reply[32];
+
+	if (hl.inter == '$' && final == 'p'){
+		// DECRQM. 1 = set, 2 = reset, 0 = not recognized
+		int state = mode == 25 ? (hl.cursor_visible ? 1 : 2) : mode == 2026 ? (hl.synchronized ? 1 : 2) : 0;
+		snprintf(reply, sizeof(reply), "\033[?%d;%d$y", mode, state);
+		__tui_hl_reply(reply);
+		return;
+	}
+	if (hl.inter != '\0' || (final != 'h' && final != 'l')){
+		return;
+	}
+	if (mode == 25){
+		hl.cursor_visible = final == 'h';
+	}
+	else if (mode == 2026){
+		hl.synchronized = final == 'h';
+	}
+}
+
+static void __tui_hl_csi(char final){
+	int n = __tui_hl_param(0, 1);
+	int row_min = hl.row >= hl.top ? hl.top : 0;
+	int row_max = hl.row <= hl.bot ? hl.bot : hl.rows - 1;
+
+	if (hl.priv == '?'){
+		__tui_hl_csi_private(final);
+		return;
+	}
+	if (hl.priv != '\0' || hl.inter != '\0'){
+		return;
+	}
+
+	switch (final){
+	case 'A':
+		__tui_hl_goto(hl.row - n < row_min ? row_min : hl.row - n, hl.col);
+		break;
+	case 'B':
+	case 'e':
+		__tui_hl_goto(hl.row + n > row_max ? row_max : hl.row + n, hl.col);
+		break;
+	case 'C':
+	case 'a':
+		__tui_hl_goto(hl.row, hl.col + n);
+		break;
+	case 'D':
+		__tui_hl_goto(hl.row, hl.col - n);
+		break;
+	case 'E':
+		__tui_hl_goto(hl.row + n > row_max ? row_max : hl.row + n, 0);
+		break;
+	case 'F':
+		__tui_hl_goto(hl.row - n < row_min ? row_min : hl.row - n, 0);
+		break;
+	case 'G':
+	case '`':
+		__tui_hl_goto(hl.row, n - 1);
+		break;
+	case 'd':
+		__tui_hl_goto(n - 1, hl.col);
+		break;
+	case 'H':
+	case 'f':
+		__tui_hl_goto(n - 1, __tui_hl_param(1, 1) - 1);
+		break;
+	case 'J':
+		switch (__tui_hl_param(0, 0)){
+		case 0:
+			__tui_hl_erase(hl.row, hl.col, hl.cols - 1);
+			for (int row = hl.row + 1; row < hl.rows; ++row){
+				__tui_hl_erase(row, 0, hl.cols - 1);
+			}
+			break;
+		case 1:
+			for (int row = 0; row < hl.row; ++row){
+				__tui_hl_erase(row, 0, hl.cols - 1);
+			}
+			__tui_hl_erase(hl.row, 0, hl.col);
+			break;
+		case 2:
+		case 3:
+			for (int row = 0; row < hl.rows; ++row){
+				__tui_hl_erase(row, 0, hl.cols - 1);
+			}
+			break;
+		}
+		break;
+	case 'K':
+		switch (__tui_hl_param(0, 0)){
+		case 0:
+			__tui_hl_erase(hl.row, hl.col, hl.cols - 1);
+			break;
+		case 1:
+			__tui_hl_erase(hl.row, 0, hl.col);
+			break;
+		case 2:
+			__tui_hl_erase(hl.row, 0, hl.cols - 1);
+			break;
+		}
+		break;
+	case 'L':
+		if (hl.row >= hl.top && hl.row <= hl.bot){
+			__tui_hl_scroll_rows(hl.row, hl.bot, -n);
+			__tui_hl_goto(hl.row, 0);
+		}
+		break;
+	case 'M':
+		if (hl.row >= hl.top && hl.row <= hl.bot){
+			__tui_hl_scroll_rows(hl.row, hl.bot, n);
+			__tui_hl_goto(hl.row, 0);
+		}
+		break;
+	case 'S':
+		__tui_hl_scroll_rows(hl.top, hl.bot, n);
+		break;
+	case 'T':
+		__tui_hl_scroll_rows(hl.top, hl.bot, -n);
+		break;
+	case 'X':
+		__tui_hl_erase(hl.row, hl.col, hl.col + n < hl.cols ? hl.col + n - 1 : hl.cols - 1);
+		hl.wrap_pending = false;
+		break;
+	case '@':
+		n = n < hl.cols - hl.col ? n : hl.cols - hl.col;
+		memmove(__tui_hl_at(hl.row, hl.col + n), __tui_hl_at(hl.row, hl.col), (size_t)(hl.cols - hl.col - n) * sizeof(tui_cell));
+		__tui_hl_erase(hl.row, hl.col, hl.col + n - 1);
+		hl.wrap_pending = false;
+		break;
+	case 'P':
+		n = n < hl.cols - hl.col ? n : hl.cols - hl.col;
+		memmove(__tui_hl_at(hl.row, hl.col), __tui_hl_at(hl.row, hl.col + n), (size_t)(hl.cols - hl.col - n) * sizeof(tui_cell));
+		__tui_hl_erase(hl.row, hl.cols - n, hl.cols - 1);
+		hl.wrap_pending = false;
+		break;
+	case 'm':
+		__tui_hl_sgr();
+		break;
+	case 'r':{
+		int top = __tui_hl_param(0, 1) - 1;
+		int bot = __tui_hl_param(1, hl.rows) - 1;
+		if (bot >= hl.rows){
+			bot = hl.rows - 1;
+		}
+		if (top < bot){
+			hl.top = top;
+			hl.bot = bot;
+			__tui_hl_goto(0, 0);
+		}
+		break;
+	}
+	case 's':
+		hl.saved.row = hl.row;
+		hl.saved.col = hl.col;
+		hl.saved.attr = hl.attr;
+		break;
+	case 'u':
+		__tui_hl_goto(hl.saved.row, hl.saved.col);
+		hl.attr = hl.saved.attr;
+		break;
+	}
+}
+
+static void __tui_hl_esc(unsigned char c){
+	hl.state = TUI_HL_GROUND;
+	switch (c){
+	case '[':
+		hl.state = TUI_HL_CSI;
+		hl.n_params = 0;
+		hl.params[0] = 0;
+		hl.priv = '\0';
+		hl.inter = '\0';
+		break;
+	case 'D':
+		__tui_hl_linefeed();
+		hl.wrap_pending = false;
+		break;
+	case 'E':
+		hl.col = 0;
+		__tui_hl_linefeed();
+		hl.wrap_pending = false;
+		break;
+	case 'M':
+		__tui_hl_reverse_linefeed();
+		hl.wrap_pending = false;
+		break;
+	case '7':
+		hl.saved.row = hl.row;
+		hl.saved.col = hl.col;
+		hl.saved.attr = hl.attr;
+		break;
+	case '8':
+		__tui_hl_goto(hl.saved.row, hl.saved.col);
+		hl.attr = hl.saved.attr;
+		break;
+	}
+}
+
+static void __tui_hl_csi_byte(unsigned char c){
+	if (c >= '0' && c <= '9'){
+		int* p;
+		if (hl.n_params == 0){
+			hl.n_params = 1;
+		}
+		p = &hl.params[hl.n_params - 1];
+		if (*p <= TUI_HL_PARAM_MAX){
+			*p = *p * 10 + (c - '0');
+		}
+		return;
+	}
+	if (c == ';'){
+		if (hl.n_params == 0){
+			hl.n_params = 1;
+		}
+		if (hl.n_params < TUI_HL_PARAMS_MAX){
+			hl.params[hl.n_params++] = 0;
+		}
+		return;
+	}
+	if (c >= 0x3C && c <= 0x3F){
+		hl.priv = (char)c;
+		return;
+	}
+	if (c >= 0x20 && c <= 0x2F){
+		hl.inter = (char)c;
+		return;
+	}
+	hl.state = TUI_HL_GROUND;
+	if (c >= 0x40 && c <= 0x7E){
+		__tui_hl_csi((char)c);
+	}
+	else if (c == '\033'){
+		hl.state = TUI_HL_ESC;
+	}
+}
+
+static void __tui_hl_ground(unsigned char c){
+	// a glyph is in progress
+	if (hl.glyph_need > 0){
+		if ((c & 0xC0) == 0x80){
+			hl.glyph[hl.glyph_len++] = (char)c;
+			if (--hl.glyph_need == 0){
+				__tui_hl_print();
+			}
+			return;
+		}
+		// truncated. drop it and handle this byte on its own
+		hl.glyph_need = 0;
+	}
+
+	switch (c){
+	case '\033':
+		hl.state = TUI_HL_ESC;
+		return;
+	case '\r':
+		hl.col = 0;
+		hl.wrap_pending = false;
+		return;
+	case '\n':
+	case '\v':
+	case '\f':
+		__tui_hl_linefeed();
+		hl.wrap_pending = false;
+		return;
+	case '\b':
+		if (hl.col > 0){
+			hl.col--;
+		}
+		hl.wrap_pending = false;
+		return;
+	case '\t':
+		__tui_hl_goto(hl.row, (hl.col / 8 + 1) * 8);
+		return;
+	}
+	if (c < 0x20 || c == 0x7F){
+		return;
+	}
+
+	hl.glyph[0] = (char)c;
+	hl.glyph_len = 1;
+	if (c < 0x80){
+		__tui_hl_print();
+	}
+	else if ((c & 0xE0) == 0xC0){
+		hl.glyph_need = 1;
+	}
+	else if ((c & 0xF0) == 0xE0){
+		hl.glyph_need = 2;
+	}
+	else if ((c & 0xF8) == 0xF0){
+		hl.glyph_need = 3;
+	}
+}
+
+/**
+ * Receives everything the encoder flushes, in order.
+ */
+static int __tui_hl_sink(const char* buf, size_t len){
+	if (!__tui_hl_init()){
+		return -1;
+	}
+	TUI_STAT_ADD(writes, 1);
+	TUI_STAT_ADD(bytes, len);
+	for (size_t i = 0; i < len; ++i){
+		unsigned char c = (unsigned char)buf[i];
+
+		switch (hl.state){
+		case TUI_HL_GROUND:
+			__tui_hl_ground(c);
+			break;
+		case TUI_HL_ESC:
+			__tui_hl_esc(c);
+			break;
+		case TUI_HL_CSI:
+			__tui_hl_csi_byte(c);
+			break;
+		}
+	}
+	return 0;
+}
+
+static tui_ansi hl_out = { NULL, 0, 0, 0, __tui_hl_sink };
+
+static tui_style __tui_hl_attrget(void){
+	return hl_out.attr_cur;
+}
+
+static void __tui_hl_attrset(tui_style attr){
+	__tui_ansi_attrset(&hl_out, attr);
+}
+
+static void __tui_hl_attrclear(void){
+	__tui_ansi_attrclear(&hl_out);
+}
+
+static int __tui_hl_getcols(void){
+	return __tui_hl_init() ? hl.cols : 80;
+}
+
+static int __tui_hl_getrows(void){
+	return __tui_hl_init() ? hl.rows : 24;
+}
+
+static int __tui_hl_resized(void){
+	bool ret = hl.resized;
+
+	hl.resized = false;
+	return ret;
+}
+
+static int __tui_hl_resize_fd(void){
+	return -1;
+}
+
+static void __tui_hl_showcursor(int enable){
+	__tui_ansi_showcursor(&hl_out, enable);
+}
+
+static int __tui_hl_setecho(int enable){
+	(void)enable;
+	return 0;
+}
+
+static void __tui_hl_setcursorpos(int row, int col){
+	__tui_ansi_setcursorpos(&hl_out, row, col);
+}
+
+static void __tui_hl_movecursorpos(int row_delta, int col_delta){
+	__tui_ansi_movecursorpos(&hl_out, row_delta, col_delta);
+}
+
+static void __tui_hl_movecursor(int from_row, int from_col, int to_row, int to_col){
+	__tui_ansi_movecursor(&hl_out, from_row, from_col, to_row, to_col);
+}
+
+static void __tui_hl_clear(void){
+	__tui_ansi_clear(&hl_out);
+}
+
+static int __tui_hl_scroll(int top, int bot, int n){
+	return __tui_ansi_scroll(&hl_out, top, bot, n);
+}
+
+static int __tui_hl_sync(int begin){
+	// the virtual screen always understands synchronized output
+	__tui_ansi_sync(&hl_out, begin);
+	return 0;
+}
+
+static int __tui_hl_write(const char* buf, size_t len){
+	__tui_ansi_write(&hl_out, buf, len);
+	return 0;
+}
+
+static int __tui_hl_flush(void){
+	return __tui_ansi_flush(&hl_out);
+}
+
+static void __tui_hl_set_esc_timeout(int ms){
+	// input never arrives in the middle of a read, so there is nothing to wait for
+	(void)ms;
+}
+
+static int __tui_hl_input_begin(void){
+	return 0;
+}
+
+static int __tui_hl_input_end(void){
+	return 0;
+}
+
+static int __tui_hl_getkeys(int* keys, size_t n){
+	size_t n_keys = 0;
+
+	while (n_keys < n && hl.keys.len > 0){
+		keys[n_keys++] = hl.keys.data[hl.keys.head++];
+		hl.keys.len--;
+	}
+	if (hl.keys.len == 0){
+		hl.keys.head = 0;
+	}
+	// the rest of the escape sequence isn't coming
+	if (n_keys < n && tui_kd_timeout(&hl.kd, &keys[n_keys])){
+		n_keys++;
+	}
+	return (int)n_keys;
+}
+
+static int __tui_hl_input_timeout(void){
+	return -1;
+}
+
+static int __tui_hl_getch(void){
+	int key;
+
+	__tui_hl_flush();
+	return __tui_hl_getkeys(&key, 1) == 1 ? key : EOF;
+}
+
+static const tui_backend backend_headless = {
+	__tui_hl_attrget,
+	__tui_hl_attrset,
+	__tui_hl_attrclear,
+	__tui_hl_getcols,
+	__tui_hl_getrows,
+	__tui_hl_resized,
+	__tui_hl_resize_fd,
+	__tui_hl_showcursor,
+	__tui_hl_setecho,
+	__tui_hl_setcursorpos,
+	__tui_hl_movecursorpos,
+	__tui_hl_movecursor,
+	__tui_ansi_movecost,
+	__tui_hl_clear,
+	__tui_hl_scroll,
+	__tui_hl_sync,
+	__tui_hl_write,
+	__tui_hl_flush,
+	__tui_hl_set_esc_timeout,
+	__tui_hl_input_begin,
+	__tui_hl_input_end,
+	__tui_hl_getkeys,
+	__tui_hl_input_timeout,
+	__tui_hl_getch
+};
+
+const tui_backend* tui_headless_backend(void){
+	return &backend_headless;
+}
+
+int tui_headless_resize(int rows, int cols){
+	// what is still buffered was meant for the old size
+	__tui_hl_flush();
+	if (__tui_hl_alloc(rows, cols) != 0){
+		return -1;
+	}
+	hl.resized = true;
+	return 0;
+}
+
+int tui_headless_input(const char* buf, size_t len){
+	for (size_t i = 0; i < len; ++i){
+		int key;
+
+		if (!tui_kd_push(&hl.kd, (unsigned char)buf[i], &key)){
+			continue;
+		}
+		if (hl.keys.head + hl.keys.len == hl.keys.cap){
+			size_t cap = hl.keys.cap ? hl.keys.cap * 2 : 64;
+			int* tmp;
+
+			// make room at the front before growing
+			if (hl.keys.head > 0){
+				memmove(hl.keys.data, hl.keys.data + hl.keys.head, hl.keys.len * sizeof(*hl.keys.data));
+				hl.keys.head = 0;
+			}
+			if (hl.keys.len == hl.keys.cap){
+				tmp = realloc(hl.keys.data, cap * sizeof(*tmp));
+				if (!tmp){
+					return -1;
+				}
+				hl.keys.data = tmp;
+				hl.keys.cap = cap;
+			}
+		}
+		hl.keys.data[hl.keys.head + hl.keys.len++] = key;
+	}
+	return 0;
+}
+
+const tui_cell* tui_headless_cell(int row, int col){
+	if (!__tui_hl_init() || row < 0 || row >= hl.rows || col < 0 || col >= hl.cols){
+		return NULL;
+	}
+	return __tui_hl_at(row, col);
+}
+
+int tui_headless_line(int row, char* buf, size_t size){
+	size_t len = 0;
+
+	if (!__tui_hl_init() || row < 0 || row >= hl.rows){
+		return -1;
+	}
+	for (int col = 0; col < hl.cols; ++col){
+		const tui_cell* c = __tui_hl_at(row, col);
+		for (size_t i = 0; i < sizeof(c->glyph) && c->glyph[i] != '\0'; ++i){
+			if (len + 1 < size){
+				buf[len] = c->glyph[i];
+			}
+			len++;
+		}
+	}
+	if (size > 0){
+		buf[len < size ? len : size - 1] = '\0';
+	}
+	return (int)len;
+}
+
+void tui_headless_cursor(int* row, int* col, int* visible){
+	if (row){
+		*row = hl.row;
+	}
+	if (col){
+		*col = hl.col;
+	}
+	if (visible){
+		*visible = hl.cursor_visible;
+	}
+}
@@ -1,4 +1,5 @@
-/** @file ctermtools.c
+/** @file backend/backend_posix.c
+ * @brief The terminal backend for POSIX systems.
  *
  * Copyright (c) 2018 Jonathan Lemos
  *
@@ -7,189 +8,175 @@
  */
 
 #include "../backend.h"
+#include "../input.h"
+#include "../stats.h"
+#include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
 
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
-static uint_fast32_t attr_cur;
+static int __tui_write_all(const char* buf, size_t len){
+	while (len > 0){
+		ssize_t n = write(STDOUT_FILENO, buf, len);
+		if (n < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			// someone else made stdout non-blocking. wait for a slow terminal to catch up instead of dropping the frame
+			if (errno == EAGAIN || errno == EWOULDBLOCK){
+				struct pollfd pfd = { STDOUT_FILENO, POLLOUT, 0 };
 
-static void tui_apply(void){
-	if (attr_cur & TUI_BOLD){
-		printf("\033[1m");
+				if (poll(&pfd, 1, -1) < 0 && errno != EINTR){
+					return -1;
+				}
+				continue;
+			}
+			return -1;
+		}
+		TUI_STAT_ADD(writes, 1);
+		TUI_STAT_ADD(bytes, (size_t)n);
+		buf += n;
+		len -= n;
 	}
-	if (attr_cur & TUI_UNDERLINE){
-		printf("\033[4m");
+	return 0;
+}
+
+static tui_ansi term = { NULL, 0, 0, 0, __tui_write_all };
+
+static tui_style __tui_posix_attrget(void){
+	return term.attr_cur;
+}
+
+static void __tui_posix_attrset(tui_style attr){
+	__tui_ansi_attrset(&term, attr);
+}
+
+static void __tui_posix_attrclear(void){
+	__tui_ansi_attrclear(&term);
+}
+
+/**
+ * @brief The last known size of the terminal.
+ * This is refreshed the next time it is needed after a SIGWINCH, instead of calling ioctl() every time.
+ */
+static struct tui_geometry{
+	int rows;
+	int cols;
+	bool valid;
+}geom;
+
+static volatile sig_atomic_t winch_pending = 0;
+static volatile sig_atomic_t winch_reported = 0;
+static int winch_pipe[2] = { -1, -1 };
+static struct sigaction winch_old;
+
+static void __tui_winch_handler(int sig){
+	int errno_old = errno;
+	char c = 0;
+
+	winch_pending = 1;
+	winch_reported = 1;
+	if (winch_pipe[1] >= 0){
+		// if the pipe is full there is already a wakeup pending
+		(void)!write(winch_pipe[1], &c, 1);
 	}
-	if (attr_cur & TUI_BLINK){
-		printf("\033[5m");
+
+	if (winch_old.sa_handler != SIG_DFL && winch_old.sa_handler != SIG_IGN && !(winch_old.sa_flags & SA_SIGINFO)){
+		winch_old.sa_handler(sig);
 	}
-	if (attr_cur & TUI_INVERT){
-		printf("\033[7m");
+	errno = errno_old;
+}
+
+static void __tui_geom_init(void){
+	static bool initialized = false;
+	struct sigaction sa;
+
+	if (initialized){
+		return;
 	}
+	initialized = true;
 
-	if (attr_cur & TUI_FG_BRIGHT){
-		if (attr_cur & TUI_FG_DEFAULT){
-			printf("\033[39m");
-		}
-		if (attr_cur & TUI_FG_BLACK){
-			printf("\033[90m");
-		}
-		if (attr_cur & TUI_FG_RED){
-			printf("\033[91m");
-		}
-		if (attr_cur & TUI_FG_GREEN){
-			printf("\033[92m");
-		}
-		if (attr_cur & TUI_FG_YELLOW){
-			printf("\033[93m");
-		}
-		if (attr_cur & TUI_FG_BLUE){
-			printf("\033[94m");
-		}
-		if (attr_cur & TUI_FG_MAGENTA){
-			printf("\033[95m");
-		}
-		if (attr_cur & TUI_FG_CYAN){
-			printf("\033[96m");
-		}
-		if (attr_cur & TUI_FG_WHITE){
-			printf("\033[97m");
+	if (pipe(winch_pipe) == 0){
+		for (int i = 0; i < 2; ++i){
+			fcntl(winch_pipe[i], F_SETFL, fcntl(winch_pipe[i], F_GETFL) | O_NONBLOCK);
+			fcntl(winch_pipe[i], F_SETFD, FD_CLOEXEC);
 		}
 	}
 	else{
-		if (attr_cur & TUI_FG_DEFAULT){
-			printf("\033[39m");
-		}
-		if (attr_cur & TUI_FG_BLACK){
-			printf("\033[30m");
-		}
-		if (attr_cur & TUI_FG_RED){
-			printf("\033[31m");
-		}
-		if (attr_cur & TUI_FG_GREEN){
-			printf("\033[32m");
-		}
-		if (attr_cur & TUI_FG_YELLOW){
-			printf("\033[33m");
-		}
-		if (attr_cur & TUI_FG_BLUE){
-			printf("\033[34m");
-		}
-		if (attr_cur & TUI_FG_MAGENTA){
-			printf("\033[35m");
-		}
-		if (attr_cur & TUI_FG_CYAN){
-			printf("\033[36m");
-		}
-		if (attr_cur & TUI_FG_WHITE){
-			printf("\033[37m");
-		}
+		winch_pipe[0] = -1;
+		winch_pipe[1] = -1;
 	}
 
-	if (attr_cur & TUI_BG_BRIGHT){
-		if (attr_cur & TUI_BG_DEFAULT){
-			printf("\033[49m");
-		}
-		if (attr_cur & TUI_BG_BLACK){
-			printf("\033[100m");
-		}
-		if (attr_cur & TUI_BG_RED){
-			printf("\033[101m");
-		}
-		if (attr_cur & TUI_BG_GREEN){
-			printf("\033[102m");
-		}
-		if (attr_cur & TUI_BG_YELLOW){
-			printf("\033[103m");
-		}
-		if (attr_cur & TUI_BG_BLUE){
-			printf("\033[104m");
-		}
-		if (attr_cur & TUI_BG_MAGENTA){
-			printf("\033[105m");
-		}
-		if (attr_cur & TUI_BG_CYAN){
-			printf("\033[106m");
-		}
-		if (attr_cur & TUI_BG_WHITE){
-			printf("\033[107m");
-		}
+	sa.sa_handler = __tui_winch_handler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGWINCH, &sa, &winch_old);
+}
+
+static void __tui_geom_refresh(void){
+	struct winsize w;
 
+	__tui_geom_init();
+	if (geom.valid && !winch_pending){
+		return;
 	}
-	else{
-		if (attr_cur & TUI_BG_DEFAULT){
-			printf("\033[49m");
-		}
-		if (attr_cur & TUI_BG_BLACK){
-			printf("\033[40m");
-		}
-		if (attr_cur & TUI_BG_RED){
-			printf("\033[41m");
-		}
-		if (attr_cur & TUI_BG_GREEN){
-			printf("\033[42m");
-		}
-		if (attr_cur & TUI_BG_YELLOW){
-			printf("\033[43m");
-		}
-		if (attr_cur & TUI_BG_BLUE){
-			printf("\033[44m");
-		}
-		if (attr_cur & TUI_BG_MAGENTA){
-			printf("\033[45m");
-		}
-		if (attr_cur & TUI_BG_CYAN){
-			printf("\033[46m");
-		}
-		if (attr_cur & TUI_BG_WHITE){
-			printf("\033[47m");
-		}
+	winch_pending = 0;
+
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) != 0 || w.ws_row == 0 || w.ws_col == 0){
+		// not a terminal. assume the traditional size
+		w.ws_row = 24;
+		w.ws_col = 80;
 	}
+	geom.rows = w.ws_row;
+	geom.cols = w.ws_col;
+	geom.valid = true;
 }
 
-void tui_attron(uint_fast32_t attr){
-	attr_cur |= attr;
-	printf("\033[0m");
-	tui_apply();
+static int __tui_posix_getcols(void){
+	__tui_geom_refresh();
+	return geom.cols;
 }
 
-void tui_attroff(uint_fast32_t attr){
-	attr_cur &= ~(attr);
-	printf("\033[0m");
-	tui_apply();
+static int __tui_posix_getrows(void){
+	__tui_geom_refresh();
+	return geom.rows;
 }
 
-void tui_attrclear(void){
-	printf("\033[0m");
-	attr_cur = 0;
-}
+static int __tui_posix_resized(void){
+	char buf[64];
 
-int tui_getcols(void){
-	struct winsize w;
-	ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-	return w.ws_col;
+	__tui_geom_init();
+	if (!winch_reported){
+		return 0;
+	}
+	winch_reported = 0;
+	if (winch_pipe[0] >= 0){
+		while (read(winch_pipe[0], buf, sizeof(buf)) > 0);
+	}
+	__tui_geom_refresh();
+	return 1;
 }
 
-int tui_getrows(void){
-	struct winsize w;
-	ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-	return w.ws_row;
+static int __tui_posix_resize_fd(void){
+	__tui_geom_init();
+	return winch_pipe[0];
 }
 
-void tui_showcursor(int enable){
-	if (enable){
-		printf("\033[?25h");
-	}
-	else{
-		printf("\033[?25l");
-	}
-	fflush(stdout);
+static void __tui_posix_showcursor(int enable){
+	__tui_ansi_showcursor(&term, enable);
 }
 
-int tui_setecho(int enable){
+static int __tui_posix_setecho(int enable){
 	struct termios term_info;
 
 	if (tcgetattr(STDIN_FILENO, &term_info) != 0){
@@ -202,67 +189,360 @@ int tui_setecho(int enable){
 	return 0;
 }
 
-void tui_setcursorpos(int row, int col){
-	row++;
-	col++;
-	printf("\033[%d;%dH", row, col);
+static void __tui_posix_setcursorpos(int row, int col){
+	__tui_ansi_setcursorpos(&term, row, col);
+}
+
+static void __tui_posix_movecursorpos(int row_delta, int col_delta){
+	__tui_ansi_movecursorpos(&term, row_delta, col_delta);
+}
+
+static void __tui_posix_movecursor(int from_row, int from_col, int to_row, int to_col){
+	__tui_ansi_movecursor(&term, from_row, from_col, to_row, to_col);
+}
+
+static void __tui_posix_clear(void){
+	__tui_ansi_clear(&term);
+}
+
+static int __tui_posix_scroll(int top, int bot, int n){
+	return __tui_ansi_scroll(&term, top, bot, n);
+}
+
+/**
+ * @brief Whether the terminal said it supports synchronized output (mode 2026).
+ * False until it answers.
+ */
+static bool sync_supported = false;
+
+static void __tui_posix_on_mode(int mode, int state){
+	// permanently set or reset means there is nothing to switch
+	if (mode == 2026){
+		sync_supported = state == 1 || state == 2;
+	}
+}
+
+static int __tui_posix_sync(int begin){
+	if (!sync_supported){
+		return -1;
+	}
+	__tui_ansi_sync(&term, begin);
+	return 0;
+}
+
+static int __tui_posix_write(const char* buf, size_t len){
+	__tui_ansi_write(&term, buf, len);
+	return 0;
+}
+
+static int __tui_posix_flush(void){
+	// text the caller printed through stdio is not part of our buffer, so send it along with the frame
 	fflush(stdout);
+	return __tui_ansi_flush(&term);
+}
+
+#define TUI_INBUF_SIZE (4096)
+
+/**
+ * @brief Bytes read from stdin that have not been decoded into keys yet.
+ * head and tail only ever increase. They are reduced modulo the size when indexing.
+ */
+static struct tui_inbuf{
+	unsigned char data[TUI_INBUF_SIZE];
+	size_t head;
+	size_t tail;
+	bool eof;
+
+	/**
+	 * @brief Holds partial escape sequences between reads.
+	 */
+	tui_keydecoder kd;
+
+	/**
+	 * @brief When bytes were last read, for timing out partial escape sequences.
+	 */
+	long long last_read_ms;
+}in;
+
+static int esc_timeout_ms = 50;
+
+/**
+ * @brief The state of an input session started with __tui_posix_input_begin().
+ */
+static struct tui_input_session{
+	bool active;
+	bool is_tty;
+	struct termios term_old;
+}session;
+
+static long long __tui_now_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static TUI_INLINE size_t __tui_in_len(void){
+	return in.tail - in.head;
+}
+
+static TUI_INLINE unsigned char __tui_in_peek(size_t i){
+	return in.data[(in.head + i) % TUI_INBUF_SIZE];
 }
 
-void tui_movecursorpos(int row_delta, int col_delta){
-	if (row_delta > 0){
-		printf("\033[%dB", row_delta);
+/**
+ * Reads everything that is available on stdin without blocking, until the ring buffer is full.
+ * stdin is left blocking, because on a terminal it shares its file status flags with stdout,
+ * so poll() decides whether there is anything to read instead.
+ *
+ * @return 0 on success, negative on a read error.
+ */
+static int __tui_in_fill(void){
+	while (__tui_in_len() < TUI_INBUF_SIZE){
+		size_t pos = in.tail % TUI_INBUF_SIZE;
+		size_t space = TUI_INBUF_SIZE - __tui_in_len();
+		struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+		struct iovec iov[2];
+		int iovcnt = 1;
+		ssize_t n;
+
+		n = poll(&pfd, 1, 0);
+		if (n < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			return -1;
+		}
+		if (n == 0){
+			return 0;
+		}
+
+		// the free space may wrap around the end of the buffer
+		iov[0].iov_base = in.data + pos;
+		iov[0].iov_len = space < TUI_INBUF_SIZE - pos ? space : TUI_INBUF_SIZE - pos;
+		if (iov[0].iov_len < space){
+			iov[1].iov_base = in.data;
+			iov[1].iov_len = space - iov[0].iov_len;
+			iovcnt = 2;
+		}
+
+		n = readv(STDIN_FILENO, iov, iovcnt);
+		if (n < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK){
+				return 0;
+			}
+			return -1;
+		}
+		if (n == 0){
+			in.eof = true;
+			return 0;
+		}
+		in.tail += n;
+		in.last_read_ms = __tui_now_ms();
 	}
-	else if (row_delta < 0){
-		printf("\033[%dA", -row_delta);
+	return 0;
+}
+
+/**
+ * Gets how long to wait for the rest of a partial escape sequence.
+ *
+ * @return The remaining time in milliseconds, 0 if it already elapsed, or -1 if no sequence is partial.
+ */
+static int __tui_in_wait_ms(void){
+	long long elapsed;
+
+	if (!tui_kd_pending(&in.kd)){
+		return -1;
 	}
-	if (col_delta > 0){
-		printf("\033[%dC", col_delta);
+	elapsed = __tui_now_ms() - in.last_read_ms;
+	return elapsed >= esc_timeout_ms ? 0 : (int)(esc_timeout_ms - elapsed);
+}
+
+/**
+ * Decodes keys from the front of the ring buffer.
+ *
+ * @return The number of keys decoded.
+ */
+static size_t __tui_in_decode(int* keys, size_t n){
+	size_t n_keys = 0;
+
+	while (n_keys < n && __tui_in_len() > 0){
+		if (tui_kd_push(&in.kd, __tui_in_peek(0), &keys[n_keys])){
+			n_keys++;
+		}
+		in.head++;
 	}
-	else if (col_delta < 0){
-		printf("\033[%dD", -col_delta);
+	return n_keys;
+}
+
+/**
+ * Starts an input session without asking the terminal anything.
+ *
+ * @return 0 on success, or -1 if the terminal modes could not be changed.
+ */
+static int __tui_posix_session_begin(void){
+	struct termios term_new;
+
+	if (session.active){
+		return 0;
 	}
-	fflush(stdout);
+
+	// input that is piped in has no terminal modes to change, but can still be read
+	session.is_tty = tcgetattr(STDIN_FILENO, &session.term_old) == 0;
+	if (!session.is_tty && errno != ENOTTY){
+		return -1;
+	}
+	if (session.is_tty){
+		term_new = session.term_old;
+		term_new.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+		term_new.c_iflag &= ~(IXON);
+		term_new.c_cc[VMIN] = 1;
+		term_new.c_cc[VTIME] = 0;
+		if (tcsetattr(STDIN_FILENO, TCSANOW, &term_new) != 0){
+			return -1;
+		}
+	}
+
+	session.active = true;
+	return 0;
 }
 
-void tui_clear(void){
-	printf("\033[2J");
-	printf("\033[1;1H");
-	fflush(stdout);
+static int __tui_posix_input_begin(void){
+	if (session.active){
+		return 0;
+	}
+	if (__tui_posix_session_begin() != 0){
+		return -1;
+	}
+
+	// the answer is only safe to ask for once it won't be echoed, and is picked out of the input by the key decoder.
+	// a session tui_getch() starts on its own ends after one key, so the answer could arrive after the terminal is back in cooked mode
+	if (session.is_tty && !in.kd.on_mode && isatty(STDOUT_FILENO)){
+		in.kd.on_mode = __tui_posix_on_mode;
+		__tui_ansi_str(&term, "\033[?2026$p");
+		__tui_posix_flush();
+	}
+	return 0;
 }
 
-int tui_getch(void){
-	struct termios old;
-	struct termios new;
-	int c;
-
-	tcgetattr(STDIN_FILENO, &old);
-	new = old;
-	new.c_lflag &= ~(ICANON | ECHO);
-	tcsetattr(STDIN_FILENO, TCSANOW, &new);
-
-	do{
-		c = getchar();
-		/* arrow keys are escape sequences:
-		 * example: up arrow == "\033[A" */
-		if (c == '\033'){
-			/* discard '[' */
-			getchar();
-			c = getchar();
-			tcsetattr(STDIN_FILENO, TCSANOW, &old);
-			switch (c){
-			case 'A':
-				return KEY_UP;
-			case 'B':
-				return KEY_DOWN;
-			case 'C':
-				return KEY_RIGHT;
-			case 'D':
-				return KEY_LEFT;
+static int __tui_posix_input_end(void){
+	int ret = 0;
+
+	if (!session.active){
+		return 0;
+	}
+	if (session.is_tty && tcsetattr(STDIN_FILENO, TCSANOW, &session.term_old) != 0){
+		ret = -1;
+	}
+	session.active = false;
+	return ret;
+}
+
+static void __tui_posix_set_esc_timeout(int ms){
+	esc_timeout_ms = ms >= 0 ? ms : 0;
+}
+
+static int __tui_posix_getkeys(int* keys, size_t n){
+	size_t n_keys = 0;
+	size_t len_old;
+
+	if (!session.active){
+		return -1;
+	}
+
+	while (n_keys < n){
+		n_keys += __tui_in_decode(keys + n_keys, n - n_keys);
+		if (n_keys == n){
+			break;
+		}
+
+		// out of bytes. see if more arrived
+		if (in.eof){
+			break;
+		}
+		len_old = __tui_in_len();
+		if (__tui_in_fill() != 0){
+			return n_keys > 0 ? (int)n_keys : -1;
+		}
+		if (__tui_in_len() == len_old){
+			break;
+		}
+	}
+
+	// the rest of the escape sequence isn't coming
+	if (n_keys < n && (in.eof || __tui_in_wait_ms() == 0) && tui_kd_timeout(&in.kd, &keys[n_keys])){
+		n_keys++;
+	}
+
+	if (n_keys == 0 && in.eof && __tui_in_len() == 0){
+		return -1;
+	}
+	return n_keys;
+}
+
+static int __tui_posix_input_timeout(void){
+	return __tui_in_wait_ms();
+}
+
+static int __tui_posix_getch(void){
+	bool temporary = !session.active;
+	int key = EOF;
+
+	// make sure the user can see what they are responding to
+	__tui_posix_flush();
+
+	if (temporary && __tui_posix_session_begin() != 0){
+		return EOF;
+	}
+
+	for (;;){
+		struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+		int n = __tui_posix_getkeys(&key, 1);
+
+		if (n != 0){
+			if (n < 0){
+				key = EOF;
 			}
+			break;
+		}
+		// wake up in time to report a lone ESC
+		if (poll(&pfd, 1, __tui_posix_input_timeout()) < 0 && errno != EINTR){
+			key = EOF;
+			break;
 		}
-	}while (c == EOF);
+	}
 
-	tcsetattr(STDIN_FILENO, TCSANOW, &old);
-	return c;
+	if (temporary){
+		__tui_posix_input_end();
+	}
+	return key;
 }
+
+static const tui_backend backend_posix = {
+	__tui_posix_attrget,
+	__tui_posix_attrset,
+	__tui_posix_attrclear,
+	__tui_posix_getcols,
+	__tui_posix_getrows,
+	__tui_posix_resized,
+	__tui_posix_resize_fd,
+	__tui_posix_showcursor,
+	__tui_posix_setecho,
+	__tui_posix_setcursorpos,
+	__tui_posix_movecursorpos,
+	__tui_posix_movecursor,
+	__tui_ansi_movecost,
+	__tui_posix_clear,
+	__tui_posix_scroll,
+	__tui_posix_sync,
+	__tui_posix_write,
+	__tui_posix_flush,
+	__tui_posix_set_esc_timeout,
+	__tui_posix_input_begin,
+	__tui_posix_input_end,
+	__tui_posix_getkeys,
+	__tui_posix_input_timeout,
+	__tui_posix_getch
+};
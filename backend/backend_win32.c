@@ -1,4 +1,5 @@
-/** @file ctermtools.c
+/** @file backend/backend_win32.c
+ * @brief The terminal backend for the Windows console.
  *
  * Copyright (c) 2018 Jonathan Lemos
  *
@@ -8,155 +9,119 @@
 
 #define TUI_EXPORTING
 #include "../backend.h"
+#include "../stats.h"
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <conio.h>
+#include <stdio.h>
 
-static uint_fast32_t attr_cur = 0;
+static tui_style attr_cur = 0;
 
-static void invert(int enabled, HANDLE hConsole, LPWORD word_ptr) {
-	static int on = 0;
-	DWORD fg_col = 0;
-	DWORD bg_col = 0;
+#define R FOREGROUND_RED
+#define G FOREGROUND_GREEN
+#define B FOREGROUND_BLUE
+#define I FOREGROUND_INTENSITY
 
-	if (enabled == on) {
-		return;
-	}
-	on = enabled;
+/**
+ * @brief The console foreground bits of each of the 16 standard colors, in ANSI order.
+ * Shifting them left by 4 gives the background bits.
+ */
+static const WORD console_colors[16] = {
+	0, R, G, R | G, B, R | B, G | B, R | G | B,
+	I, R | I, G | I, R | G | I, B | I, R | B | I, G | B | I, R | G | B | I
+};
+
+#undef R
+#undef G
+#undef B
+#undef I
+
+/**
+ * Gets the closest of the 16 standard colors to a 24-bit color.
+ */
+static int __tui_win32_nearest16(uint32_t rgb){
+	int r = rgb >> 16 & 0xFF;
+	int g = rgb >> 8 & 0xFF;
+	int b = rgb & 0xFF;
+	int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+	int index = (r > max / 2 ? 1 : 0) | (g > max / 2 ? 2 : 0) | (b > max / 2 ? 4 : 0);
 
-	if ((*word_ptr) & FOREGROUND_RED) {
-		bg_col |= BACKGROUND_RED;
-	}
-	if ((*word_ptr) & FOREGROUND_GREEN) {
-		bg_col |= BACKGROUND_GREEN;
-	}
-	if ((*word_ptr) & FOREGROUND_BLUE) {
-		bg_col |= BACKGROUND_BLUE;
-	}
-	if ((*word_ptr) & FOREGROUND_INTENSITY) {
-		bg_col |= BACKGROUND_INTENSITY;
-	}
-	if ((*word_ptr) & BACKGROUND_RED) {
-		fg_col |= FOREGROUND_RED;
-	}
-	if ((*word_ptr) & BACKGROUND_GREEN) {
-		fg_col |= FOREGROUND_GREEN;
-	}
-	if ((*word_ptr) & BACKGROUND_BLUE) {
-		fg_col |= FOREGROUND_BLUE;
-	}
-	if ((*word_ptr) & BACKGROUND_INTENSITY) {
-		fg_col |= FOREGROUND_INTENSITY;
+	if (max < 64){
+		return 0;
 	}
-	(*word_ptr) &= ~(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY |
-		BACKGROUND_RED | BACKGROUND_GREEN | BACKGROUND_BLUE | BACKGROUND_INTENSITY);
+	return max > 191 ? index + 8 : index;
+}
 
-	(*word_ptr) |= (fg_col | bg_col);
+/**
+ * Gets the standard color (0-15) that the console shows for a color of a style.
+ *
+ * @return The color, or def if the style uses the default color.
+ */
+static int __tui_win32_color16(int mode, uint32_t value, int def){
+	static const int cube[6] = { 0, 95, 135, 175, 215, 255 };
+
+	switch (mode){
+	case TUI_COLOR_16:
+		return (int)value;
+	case TUI_COLOR_256:
+		if (value < 16){
+			return (int)value;
+		}
+		if (value >= 232){
+			int gray = 8 + 10 * ((int)value - 232);
+			return __tui_win32_nearest16((uint32_t)(gray << 16 | gray << 8 | gray));
+		}
+		value -= 16;
+		return __tui_win32_nearest16((uint32_t)(cube[value / 36] << 16 | cube[value / 6 % 6] << 8 | cube[value % 6]));
+	case TUI_COLOR_RGB:
+		return __tui_win32_nearest16(value);
+	default:
+		return def;
+	}
 }
 
 static void tui_apply(void) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-	WORD wAttributes = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+	WORD fg;
+	WORD bg;
 
 	if (!hConsole) {
 		return;
 	}
+	TUI_STAT_ADD(sgr, 1);
 
-	if (attr_cur & TUI_FG_DEFAULT) {
-		wAttributes |= FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
-	}
-	if (attr_cur & TUI_FG_BLACK) {
-		wAttributes &= ~(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
-	}
-	if (attr_cur & TUI_FG_RED) {
-		wAttributes &= ~(FOREGROUND_GREEN | FOREGROUND_BLUE);
-		wAttributes |= FOREGROUND_RED;
-	}
-	if (attr_cur & TUI_FG_GREEN) {
-		wAttributes &= ~(FOREGROUND_RED | FOREGROUND_BLUE);
-		wAttributes |= FOREGROUND_GREEN;
-	}
-	if (attr_cur & TUI_FG_YELLOW) {
-		wAttributes &= ~(FOREGROUND_BLUE);
-		wAttributes |= FOREGROUND_RED | FOREGROUND_GREEN;
-	}
-	if (attr_cur & TUI_FG_BLUE) {
-		wAttributes &= ~(FOREGROUND_RED | FOREGROUND_GREEN);
-		wAttributes |= FOREGROUND_BLUE;
-	}
-	if (attr_cur & TUI_FG_MAGENTA) {
-		wAttributes &= ~(FOREGROUND_GREEN);
-		wAttributes |= FOREGROUND_BLUE | FOREGROUND_RED;
-	}
-	if (attr_cur & TUI_FG_CYAN) {
-		wAttributes &= ~(FOREGROUND_RED);
-		wAttributes |= FOREGROUND_GREEN | FOREGROUND_BLUE;
-	}
-	if (attr_cur & TUI_FG_WHITE) {
-		wAttributes |= FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
-	}
-	if (attr_cur & (TUI_FG_BRIGHT | tui_BOLD)) {
-		wAttributes |= FOREGROUND_INTENSITY;
-	}
-
-	if (attr_cur & TUI_BG_DEFAULT) {
-		wAttributes &= ~(BACKGROUND_RED | BACKGROUND_GREEN | BACKGROUND_BLUE | BACKGROUND_INTENSITY);
-	}
-	if (attr_cur & TUI_BG_BLACK) {
-		wAttributes &= ~(BACKGROUND_RED | BACKGROUND_GREEN | BACKGROUND_BLUE);
-	}
-	if (attr_cur & TUI_BG_RED) {
-		wAttributes &= ~(BACKGROUND_GREEN | BACKGROUND_BLUE);
-		wAttributes |= BACKGROUND_RED;
-	}
-	if (attr_cur & TUI_BG_GREEN) {
-		wAttributes &= ~(BACKGROUND_RED | BACKGROUND_BLUE);
-		wAttributes |= BACKGROUND_GREEN;
-	}
-	if (attr_cur & TUI_BG_YELLOW) {
-		wAttributes &= ~(BACKGROUND_BLUE);
-		wAttributes |= BACKGROUND_RED | BACKGROUND_GREEN;
+	fg = console_colors[__tui_win32_color16(TUI_STYLE_FG_MODE(attr_cur), TUI_STYLE_FG_VALUE(attr_cur), 7)];
+	bg = console_colors[__tui_win32_color16(TUI_STYLE_BG_MODE(attr_cur), TUI_STYLE_BG_VALUE(attr_cur), 0)];
+	if (attr_cur & TUI_BOLD) {
+		fg |= FOREGROUND_INTENSITY;
 	}
-	if (attr_cur & TUI_BG_BLUE) {
-		wAttributes &= ~(BACKGROUND_RED | BACKGROUND_GREEN);
-		wAttributes |= BACKGROUND_BLUE;
+	if (attr_cur & TUI_INVERT) {
+		WORD tmp = fg;
+		fg = bg;
+		bg = tmp;
 	}
-	if (attr_cur & TUI_BG_MAGENTA) {
-		wAttributes &= ~(BACKGROUND_GREEN);
-		wAttributes |= BACKGROUND_BLUE | BACKGROUND_RED;
-	}
-	if (attr_cur & TUI_BG_CYAN) {
-		wAttributes &= ~(BACKGROUND_RED);
-		wAttributes |= BACKGROUND_GREEN | BACKGROUND_BLUE;
-	}
-	if (attr_cur & TUI_BG_WHITE) {
-		wAttributes |= BACKGROUND_RED | BACKGROUND_GREEN | BACKGROUND_BLUE;
-	}
-	if (attr_cur & TUI_BG_BRIGHT) {
-		wAttributes |= BACKGROUND_INTENSITY;
-	}
-
-	invert(attr_cur & TUI_INVERT ? 1 : 0, hConsole, &wAttributes);
-	SetConsoleTextAttribute(hConsole, wAttributes);
+	SetConsoleTextAttribute(hConsole, fg | bg << 4);
 }
 
-void tui_attron(uint_fast32_t attr) {
-	attr_cur |= attr;
-	tui_apply();
+static tui_style __tui_win32_attrget(void) {
+	return attr_cur;
 }
 
-void tui_attroff(uint_fast32_t attr) {
-	attr_cur &= ~(attr);
-	tui_apply();
-}
-
-void tui_attrclear(void) {
+static void __tui_win32_attrclear(void) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-	attr_cur = TUI_FG_DEFAULT | tui_BG_DEFAULT;
+	attr_cur = TUI_NORMAL;
 	SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
 }
 
-int tui_getrows(void) {
+static void __tui_win32_attrset(tui_style attr) {
+	if (attr == attr_cur) {
+		return;
+	}
+	attr_cur = attr;
+	tui_apply();
+}
+
+static int __tui_win32_getrows(void) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 	CONSOLE_SCREEN_BUFFER_INFO csbi;
 
@@ -167,7 +132,7 @@ int tui_getrows(void) {
 	return csbi.srWindow.Right - csbi.srWindow.Left + 1;
 }
 
-int tui_getcols(void) {
+static int __tui_win32_getcols(void) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 	CONSOLE_SCREEN_BUFFER_INFO csbi;
 
@@ -178,7 +143,23 @@ int tui_getcols(void) {
 	return csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
 }
 
-void tui_showcursor(int enable) {
+static int __tui_win32_resized(void) {
+	static int rows_last = -1;
+	static int cols_last = -1;
+	int rows = __tui_win32_getrows();
+	int cols = __tui_win32_getcols();
+	int ret = rows_last >= 0 && (rows != rows_last || cols != cols_last);
+
+	rows_last = rows;
+	cols_last = cols;
+	return ret;
+}
+
+static int __tui_win32_resize_fd(void) {
+	return -1;
+}
+
+static void __tui_win32_showcursor(int enable) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 	CONSOLE_CURSOR_INFO cci;
 
@@ -190,7 +171,7 @@ void tui_showcursor(int enable) {
 	SetConsoleCursorInfo(hConsole, &cci) ? 0 : -1;
 }
 
-int tui_setecho(int enable) {
+static int __tui_win32_setecho(int enable) {
 	HANDLE hConsole = GetStdHandle(STD_INPUT_HANDLE);
 	DWORD dwMode;
 
@@ -202,10 +183,12 @@ int tui_setecho(int enable) {
 	return SetConsoleMode(hConsole, dwMode) ? 0 : -1;
 }
 
-void tui_setcursorpos(int row, int col) {
+static void __tui_win32_setcursorpos(int row, int col) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 	COORD dwCursorPosition = { col, row };
 
+	TUI_STAT_ADD(cursor_moves, 1);
+
 	if (!hConsole) {
 		return;
 	}
@@ -213,11 +196,11 @@ void tui_setcursorpos(int row, int col) {
 	SetConsoleCursorPosition(hConsole, dwCursorPosition);
 }
 
-void tui_movecursorpos(int row_delta, int col_delta) {
+static void __tui_win32_movecursorpos(int row_delta, int col_delta) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 	CONSOLE_SCREEN_BUFFER_INFO csbi;
-	int row_max = tui_getrows();
-	int col_max = tui_getcols();
+	int row_max = __tui_win32_getrows();
+	int col_max = __tui_win32_getcols();
 
 	if (!hConsole || !GetConsoleScreenBufferInfo(hConsole, &csbi)) {
 		return;
@@ -228,7 +211,22 @@ void tui_movecursorpos(int row_delta, int col_delta) {
 	SetConsoleCursorPosition(hConsole, csbi.dwCursorPosition);
 }
 
-void tui_clear(void) {
+static void __tui_win32_movecursor(int from_row, int from_col, int to_row, int to_col) {
+	// the console API moves the cursor in one call no matter where it starts
+	(void)from_row;
+	(void)from_col;
+	__tui_win32_setcursorpos(to_row, to_col);
+}
+
+static int __tui_win32_movecost(int from_row, int from_col, int to_row, int to_col) {
+	(void)from_row;
+	(void)from_col;
+	(void)to_row;
+	(void)to_col;
+	return 0;
+}
+
+static void __tui_win32_clear(void) {
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 	COORD coordHome = { 0, 0 };
 	CONSOLE_SCREEN_BUFFER_INFO csbi;
@@ -250,10 +248,77 @@ void tui_clear(void) {
 	SetConsoleCursorPosition(hConsole, coordHome);
 }
 
-int tui_getch(void) {
+static int __tui_win32_scroll(int top, int bot, int n) {
+	/* the console has no scrolling regions. the caller redraws the rows instead */
+	(void)top;
+	(void)bot;
+	(void)n;
+	return -1;
+}
+
+static int __tui_win32_sync(int begin) {
+	/* the console has no way to hold off repainting */
+	(void)begin;
+	return -1;
+}
+
+static int __tui_win32_write(const char* buf, size_t len) {
+	/* cursor and attribute changes take effect immediately on the console,
+	 * so text cannot be held back until __tui_win32_flush() without reordering it */
+	TUI_STAT_ADD(writes, 1);
+	TUI_STAT_ADD(bytes, len);
+	if (fwrite(buf, 1, len, stdout) != len) {
+		return -1;
+	}
+	return fflush(stdout) == 0 ? 0 : -1;
+}
+
+static int __tui_win32_flush(void) {
+	return fflush(stdout) == 0 ? 0 : -1;
+}
+
+static void __tui_win32_set_esc_timeout(int ms) {
+	/* the console reports special keys as whole events, so there is nothing to wait for */
+	(void)ms;
+}
+
+static int __tui_win32_input_begin(void) {
+	/* _getch() already reads the console unbuffered and without echo */
+	return 0;
+}
+
+static int __tui_win32_input_end(void) {
+	return 0;
+}
+
+static int __tui_win32_getch(void);
+
+static int __tui_win32_getkeys(int* keys, size_t n) {
+	size_t n_keys = 0;
+
+	while (n_keys < n && _kbhit()) {
+		keys[n_keys++] = __tui_win32_getch();
+	}
+	return (int)n_keys;
+}
+
+static int __tui_win32_input_timeout(void) {
+	return -1;
+}
+
+static int __tui_win32_getch(void) {
 	int c = 0;
 	do {
 		c = _getch();
+		if (c == 0) {
+			/* F1-F10 */
+			c = _getch();
+			if (c >= 59 && c <= 68) {
+				return KEY_F(c - 58);
+			}
+			c = 0;
+			continue;
+		}
 		if (c == 224) {
 			c = _getch();
 			switch (c) {
@@ -265,6 +330,22 @@ int tui_getch(void) {
 				return KEY_LEFT;
 			case 77:
 				return KEY_RIGHT;
+			case 71:
+				return KEY_HOME;
+			case 79:
+				return KEY_END;
+			case 73:
+				return KEY_PGUP;
+			case 81:
+				return KEY_PGDOWN;
+			case 82:
+				return KEY_INSERT;
+			case 83:
+				return KEY_DELETE;
+			case 133:
+				return KEY_F(11);
+			case 134:
+				return KEY_F(12);
 			}
 		}
 		if (c == '\r') {
@@ -276,3 +357,30 @@ int tui_getch(void) {
 	} while (c == 0);
 	return c;
 }
+
+static const tui_backend backend_win32 = {
+	__tui_win32_attrget,
+	__tui_win32_attrset,
+	__tui_win32_attrclear,
+	__tui_win32_getcols,
+	__tui_win32_getrows,
+	__tui_win32_resized,
+	__tui_win32_resize_fd,
+	__tui_win32_showcursor,
+	__tui_win32_setecho,
+	__tui_win32_setcursorpos,
+	__tui_win32_movecursorpos,
+	__tui_win32_movecursor,
+	__tui_win32_movecost,
+	__tui_win32_clear,
+	__tui_win32_scroll,
+	__tui_win32_sync,
+	__tui_win32_write,
+	__tui_win32_flush,
+	__tui_win32_set_esc_timeout,
+	__tui_win32_input_begin,
+	__tui_win32_input_end,
+	__tui_win32_getkeys,
+	__tui_win32_input_timeout,
+	__tui_win32_getch
+};
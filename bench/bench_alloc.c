@@ -0,0 +1,140 @@
+/** @file bench/bench_alloc.c
+ * @brief Counts the heap allocations made while creating and freeing window trees.
+ * Usage: bench_alloc<br>
+ * Link with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free so the allocations can be counted.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "window.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define N (100000)
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static size_t n_allocs;
+static size_t n_frees;
+
+void* __wrap_malloc(size_t size){
+	n_allocs++;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size){
+	n_allocs++;
+	return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size){
+	n_allocs++;
+	return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr){
+	if (ptr){
+		n_frees++;
+	}
+	__real_free(ptr);
+}
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static tui_window* make_root(void){
+	tui_window* root;
+
+	if (tui_win_make(NULL, &root) != TUI_OK){
+		fprintf(stderr, "tui_win_make failed\n");
+		exit(1);
+	}
+	return root;
+}
+
+static void report(const char* name, double ns, size_t allocs, size_t frees){
+	printf("%-28s %8.1f ns/window, %7zu allocations, %7zu frees\n", name, ns / N, allocs, frees);
+}
+
+/* N children of one window, made one at a time */
+static tui_window* build_wide(void){
+	tui_window* root = make_root();
+
+	for (size_t i = 0; i < N; ++i){
+		tui_window* w;
+		if (tui_win_make(root, &w) != TUI_OK){
+			fprintf(stderr, "tui_win_make failed\n");
+			exit(1);
+		}
+	}
+	return root;
+}
+
+/* N children of one window, made together */
+static tui_window* build_wide_n(void){
+	tui_window* root = make_root();
+	tui_window** wins = malloc(N * sizeof(*wins));
+
+	if (!wins || tui_win_make_n(root, N, wins) != TUI_OK){
+		fprintf(stderr, "tui_win_make_n failed\n");
+		exit(1);
+	}
+	free(wins);
+	return root;
+}
+
+/* every window is the only child of the previous one */
+static tui_window* build_deep(void){
+	tui_window* root = make_root();
+	tui_window* parent = root;
+
+	for (size_t i = 0; i < N; ++i){
+		if (tui_win_make(parent, &parent) != TUI_OK){
+			fprintf(stderr, "tui_win_make failed\n");
+			exit(1);
+		}
+	}
+	return root;
+}
+
+static void run(const char* name, tui_window* (*build)(void)){
+	char label[64];
+	size_t allocs = n_allocs;
+	size_t frees = n_frees;
+	double start = now_ns();
+	tui_window* root = build();
+	double end = now_ns();
+
+	snprintf(label, sizeof(label), "%s make", name);
+	report(label, end - start, n_allocs - allocs, n_frees - frees);
+
+	allocs = n_allocs;
+	frees = n_frees;
+	start = now_ns();
+	tui_win_free(root);
+	end = now_ns();
+
+	snprintf(label, sizeof(label), "%s free", name);
+	report(label, end - start, n_allocs - allocs, n_frees - frees);
+}
+
+int main(void){
+	// get stdwin set up so it is not counted
+	(void)stdwin;
+
+	printf("%d windows per tree\n", N);
+	run("wide (cold pool)", build_wide);
+	run("wide (warm pool)", build_wide);
+	run("wide tui_win_make_n", build_wide_n);
+	run("deep", build_deep);
+	return 0;
+}
@@ -0,0 +1,138 @@
+/** @file bench/bench_constraint.c
+ * @brief Measures how long the constraint strategy takes to position grids of windows placed relative to each other.
+ * The solver is timed on its own, and a whole tui_layout() is timed for comparison.
+ * Usage: bench_constraint<br>
+ * The layout only looks at the windows the solver positioned, so it exits with 1 if a layout after one size changed costs more than a tenth of solving everything.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "window.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define REPS (50)
+#define COLS (64)
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void check(int ret, const char* what){
+	if (ret != TUI_OK){
+		fprintf(stderr, "%s: %s\n", what, tui_strerr(ret));
+		exit(1);
+	}
+}
+
+/* every window is right of the one before it in its row and below the one above it in its column */
+static tui_window** build_grid(tui_window* root, size_t n){
+	tui_window** wins = malloc(n * sizeof(*wins));
+
+	if (!wins){
+		perror("malloc");
+		exit(1);
+	}
+	check(tui_win_make_n(root, n, wins), "tui_win_make_n");
+	for (size_t i = 0; i < n; ++i){
+		check(tui_win_set(wins[i], TUI_SET_GRAVITY, TUI_GRAV_LEFT | TUI_GRAV_TOP), "gravity");
+		check(tui_win_set(wins[i], TUI_SET_WIDTH, 8), "width");
+		check(tui_win_set(wins[i], TUI_SET_HEIGHT, 2), "height");
+		if (i % COLS != 0){
+			check(tui_win_set(wins[i], TUI_SET_PLACE_RIGHTOF, wins[i - 1]), "rightof");
+		}
+		if (i >= COLS){
+			check(tui_win_set(wins[i], TUI_SET_PLACE_BELOW, wins[i - COLS]), "below");
+		}
+	}
+	return wins;
+}
+
+/**
+ * @return False if the layout after one size changed cost more than a tenth of solving everything.
+ */
+static bool run(size_t n){
+	tui_window root = { 0 };
+	tui_window** wins;
+	size_t mi;
+	tui_window* mid;
+	tui_window* first;
+	double full = 0;
+	double size = 0;
+	double place = 0;
+	double row = 0;
+	double layout = 0;
+
+	root.pos.total = (tui_container){ 0, 999999999, 0, 999999999 };
+	root.pos.usable = root.pos.total;
+	check(tui_win_set(&root, TUI_SET_CPOS, TUI_CPOS_CONSTRAINT), "cpos");
+
+	wins = build_grid(&root, n);
+	mi = n / 2 - n / 2 % COLS + COLS / 2;
+	mid = wins[mi];
+	first = wins[mi - COLS / 2];
+	check(tui_layout(&root), "layout");
+
+	for (int rep = 0; rep < REPS; ++rep){
+		double start;
+
+		// the usable area changes, so everything is positioned again
+		tui_win_set(&root, TUI_SET_X_PADDING, rep % 2);
+		start = now_ns();
+		tui_cons_calcchildren(&root);
+		full += now_ns() - start;
+
+		// moves the second half of one row
+		tui_win_set(mid, TUI_SET_WIDTH, rep % 2 ? 8 : 9);
+		start = now_ns();
+		tui_cons_calcchildren(&root);
+		size += now_ns() - start;
+
+		// moves the second half of one row up or down
+		tui_win_set(mid, TUI_SET_PLACE_BELOW, wins[mi - COLS + rep % 2]);
+		start = now_ns();
+		tui_cons_calcchildren(&root);
+		place += now_ns() - start;
+
+		// moves a whole row
+		tui_win_set(first, TUI_SET_WIDTH, rep % 2 ? 8 : 9);
+		start = now_ns();
+		tui_cons_calcchildren(&root);
+		row += now_ns() - start;
+
+		// lays out what the solves above moved, so the next layout only finds what one size moved
+		tui_layout(&root);
+
+		// the same as one size, but including finding the windows that moved
+		tui_win_set(mid, TUI_SET_HEIGHT, rep % 2 ? 2 : 3);
+		start = now_ns();
+		tui_layout(&root);
+		layout += now_ns() - start;
+	}
+
+	printf("%7zu windows: solve all %6.1f ns/window, one size %7.0f ns, one constraint %7.0f ns, one row %7.0f ns, layout after one size %9.0f ns\n",
+		n, full / REPS / n, size / REPS, place / REPS, row / REPS, layout / REPS);
+	// the windows are not freed. the process is about to exit
+	free(wins);
+	if (layout * 10 > full){
+		fprintf(stderr, "%zu windows: a layout after one size changed costs %.0f%% of solving everything\n", n, layout * 100 / full);
+		return false;
+	}
+	return true;
+}
+
+int main(void){
+	size_t sizes[] = { 1024, 8192, 65536 };
+	bool ok = true;
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i){
+		ok &= run(sizes[i]);
+	}
+	return ok ? 0 : 1;
+}
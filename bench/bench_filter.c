@@ -0,0 +1,119 @@
+/** @file bench/bench_filter.c
+ * @brief Measures how quickly a filter over a large list answers a query typed one character at a time.
+ * Usage: bench_filter [choices] [query]<br>
+ * Link with -lpthread.<br>
+ * For each keystroke, "first" is how long it took for the first results to be reported and "done" how long the whole search took.
+ * Every query is run on one thread and on one per processor, and again with every prefix searched from scratch instead of narrowed.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "filter.h"
+#include "window.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Waits for a query's search to finish, the way a caller watching the filter's fd would.
+ */
+static void wait_done(tui_filter* f, size_t* out, double start, double* first, double* done){
+	struct pollfd pfd = { .fd = tui_filter_fd(f), .events = POLLIN };
+	size_t n;
+	size_t matched;
+
+	*first = -1;
+	for (;;){
+		int complete;
+
+		poll(&pfd, 1, -1);
+		complete = tui_filter_results(f, out, &n, &matched);
+		if (*first < 0 && (n > 0 || complete)){
+			*first = now_ns() - start;
+		}
+		if (complete){
+			*done = now_ns() - start;
+			return;
+		}
+	}
+}
+
+static void run(const char* const* choices, size_t len, const char* query, int threads, int narrow){
+	enum { K = 50 };
+	size_t out[K];
+	char prefix[256];
+	size_t qlen = strlen(query);
+	double first;
+	double done;
+	double total = 0;
+	tui_filter* f;
+
+	if (tui_filter_make(choices, len, K, threads, &f) != TUI_OK){
+		fprintf(stderr, "tui_filter_make failed\n");
+		exit(1);
+	}
+	wait_done(f, out, now_ns(), &first, &done);
+
+	printf("threads %-3s %-8s", threads == 1 ? "1" : "all", narrow ? "narrow" : "rescan");
+	for (size_t i = 1; i <= qlen && i < sizeof(prefix); ++i){
+		double t;
+
+		memcpy(prefix, query, i);
+		prefix[i] = '\0';
+		if (!narrow){
+			// a query that no other starts with makes the next one search everything again
+			tui_filter_query(f, "\x01");
+			wait_done(f, out, now_ns(), &first, &done);
+		}
+		t = now_ns();
+		tui_filter_query(f, prefix);
+		wait_done(f, out, t, &first, &done);
+		total += done;
+		printf("  %s %.1f/%.1fms", prefix, first / 1e6, done / 1e6);
+	}
+	printf("  total %.1fms\n", total / 1e6);
+	tui_filter_free(f);
+}
+
+int main(int argc, char** argv){
+	size_t len = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+	const char* query = argc > 2 ? argv[2] : "ho42ex";
+	char* text;
+	const char** choices;
+
+	if (len == 0){
+		fprintf(stderr, "Usage: %s [choices] [query]\n", argv[0]);
+		return 1;
+	}
+	text = malloc(len * 48);
+	choices = malloc(len * sizeof(*choices));
+	if (!text || !choices){
+		perror("malloc");
+		return 1;
+	}
+	srand(1);
+	for (size_t i = 0; i < len; ++i){
+		static const char* const dirs[] = { "src", "include", "docs", "tests", "build", "third_party" };
+		snprintf(text + i * 48, 48, "%s/host-%zu/%x.example.com", dirs[rand() % 6], i, rand());
+		choices[i] = text + i * 48;
+	}
+
+	for (int narrow = 1; narrow >= 0; --narrow){
+		run(choices, len, query, 1, narrow);
+		run(choices, len, query, 0, narrow);
+	}
+
+	free(choices);
+	free(text);
+	return 0;
+}
@@ -0,0 +1,399 @@
+/** @file bench/bench_gravity.c
+ * @brief Checks the gravity strategy against a straightforward reference implementation on random windows,
+ * then measures its throughput and how long a child takes to join a bucket.
+ * Usage: bench_gravity [iterations]<br>
+ * Exits with a nonzero status if the two implementations ever disagree,
+ * or if tui_show() does not restack children after tui_win_raise() and tui_win_lower().<br>
+ * The random layouts raise and lower children between layouts, so the stacking order is checked after reordering too.
+ * The parent keeps its size between most of them, so the children that did not change are not positioned again.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "window.h"
+#include "headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_CHILDREN (48)
+#define REPS (20)
+
+static const tui_gravity gravities[] = {
+	TUI_GRAV_CENTER,
+	TUI_GRAV_LEFT,
+	TUI_GRAV_RIGHT,
+	TUI_GRAV_TOP,
+	TUI_GRAV_BOT,
+	TUI_GRAV_LEFT | TUI_GRAV_TOP,
+	TUI_GRAV_LEFT | TUI_GRAV_BOT,
+	TUI_GRAV_RIGHT | TUI_GRAV_TOP,
+	TUI_GRAV_RIGHT | TUI_GRAV_BOT
+};
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* the same as the first pass of tui_grav_calcchildren() */
+static void ref_initial(tui_window* win){
+	for (tui_window* child = win->children.first; child; child = child->next){
+		if (child->width != TUI_MATCH_PARENT){
+			if (child->gravity & TUI_GRAV_LEFT){
+				child->pos.total.col_left = win->pos.usable.col_left;
+				child->pos.total.col_right = win->pos.usable.col_left + child->width;
+			}
+			else if (child->gravity & TUI_GRAV_RIGHT){
+				child->pos.total.col_left = win->pos.usable.col_right - child->width;
+				child->pos.total.col_right = win->pos.usable.col_right;
+			}
+			else{
+				child->pos.total.col_left = (win->pos.usable.col_left + win->pos.usable.col_right) / 2 - child->width / 2;
+				child->pos.total.col_right = child->pos.total.col_left + child->width;
+			}
+		}
+		if (child->height != TUI_MATCH_PARENT){
+			if (child->gravity & TUI_GRAV_TOP){
+				child->pos.total.row_top = win->pos.usable.row_top;
+				child->pos.total.row_bot = win->pos.usable.row_top + child->height;
+			}
+			else if (child->gravity & TUI_GRAV_BOT){
+				child->pos.total.row_top = win->pos.usable.row_bot - child->height;
+				child->pos.total.row_bot = win->pos.usable.row_bot;
+			}
+			else{
+				child->pos.total.row_top = (win->pos.usable.row_top + win->pos.usable.row_bot) / 2 - child->height / 2;
+				child->pos.total.row_bot = child->pos.total.row_top + child->height;
+			}
+		}
+	}
+}
+
+static int stacked(tui_window* child, tui_gravity g){
+	int size = g == TUI_GRAV_LEFT || g == TUI_GRAV_RIGHT ? child->width : child->height;
+	return child->gravity == g && size != TUI_MATCH_PARENT;
+}
+
+/* scans every child twice per edge, like the gravity strategy used to */
+static int ref_collisions(tui_window* win, tui_container* out){
+	int left_edge  = win->pos.usable.col_left;
+	int right_edge = win->pos.usable.col_right;
+	int top_edge   = win->pos.usable.row_top;
+	int bot_edge   = win->pos.usable.row_bot;
+	tui_window* child;
+
+	for (child = win->children.first; child && !stacked(child, TUI_GRAV_LEFT); child = child->next);
+	if (child){
+		left_edge = child->pos.total.col_right + 1;
+		child = child->next;
+	}
+	for (; child; child = child->next){
+		if (stacked(child, TUI_GRAV_LEFT)){
+			child->pos.total.col_left  += left_edge - win->pos.usable.col_left;
+			child->pos.total.col_right += left_edge - win->pos.usable.col_left;
+			left_edge = child->pos.total.col_right + 1;
+		}
+	}
+
+	for (child = win->children.first; child && !stacked(child, TUI_GRAV_RIGHT); child = child->next);
+	if (child){
+		right_edge = child->pos.total.col_left - 1;
+		child = child->next;
+	}
+	for (; child; child = child->next){
+		if (stacked(child, TUI_GRAV_RIGHT)){
+			int diff = child->pos.total.col_right - child->pos.total.col_left;
+			child->pos.total.col_left  = right_edge - diff;
+			child->pos.total.col_right = right_edge;
+			right_edge = child->pos.total.col_left - 1;
+		}
+	}
+
+	for (child = win->children.first; child && !stacked(child, TUI_GRAV_TOP); child = child->next);
+	if (child){
+		top_edge = child->pos.total.row_bot + 1;
+		child = child->next;
+	}
+	for (; child; child = child->next){
+		if (stacked(child, TUI_GRAV_TOP)){
+			child->pos.total.row_top += top_edge - win->pos.usable.row_top;
+			child->pos.total.row_bot += top_edge - win->pos.usable.row_top;
+			top_edge = child->pos.total.row_bot + 1;
+		}
+	}
+
+	for (child = win->children.first; child && !stacked(child, TUI_GRAV_BOT); child = child->next);
+	if (child){
+		bot_edge = child->pos.total.row_top - 1;
+		child = child->next;
+	}
+	for (; child; child = child->next){
+		if (stacked(child, TUI_GRAV_BOT)){
+			int diff = child->pos.total.row_bot - child->pos.total.row_top;
+			child->pos.total.row_top = bot_edge - diff;
+			child->pos.total.row_bot = bot_edge;
+			bot_edge = child->pos.total.row_top - 1;
+		}
+	}
+
+	if (left_edge > right_edge || top_edge > bot_edge){
+		return TUI_ENOSPC;
+	}
+	*out = (tui_container){ top_edge, bot_edge, left_edge, right_edge };
+	return TUI_OK;
+}
+
+static int ref_calcchildren(tui_window* win){
+	tui_container area;
+	int ret;
+
+	ref_initial(win);
+	if ((ret = ref_collisions(win, &area)) != TUI_OK){
+		return ret;
+	}
+	for (tui_window* child = win->children.first; child; child = child->next){
+		if (child->width == TUI_MATCH_PARENT){
+			child->pos.total.col_left  = area.col_left + 1;
+			child->pos.total.col_right = area.col_right - 1;
+		}
+		if (child->height == TUI_MATCH_PARENT){
+			child->pos.total.row_top   = area.row_top + 1;
+			child->pos.total.row_bot   = area.row_bot - 1;
+		}
+		__tui_calcusablespace(child);
+	}
+	return TUI_OK;
+}
+
+static int rnd_size(void){
+	return rand() % 8 == 0 ? TUI_MATCH_PARENT : rand() % 12;
+}
+
+/* makes, frees, restacks and changes random children, then checks that both implementations agree */
+static int check(tui_window* root, tui_window** wins, size_t* n){
+	tui_container got[MAX_CHILDREN];
+	tui_window* w = *n ? wins[rand() % *n] : NULL;
+	int got_ret;
+	int want_ret;
+	size_t i;
+
+	switch (rand() % 8){
+	case 0:
+	case 1:
+		if (*n < MAX_CHILDREN && tui_win_make(root, &wins[*n]) == TUI_OK){
+			w = wins[(*n)++];
+		}
+		break;
+	case 2:
+		if (w){
+			tui_win_free(w);
+			for (i = 0; wins[i] != w; ++i);
+			wins[i] = wins[--*n];
+			w = NULL;
+		}
+		break;
+	case 3:
+	case 4:
+		// restack a few children and lay out right away, so the buckets are compared after nothing but the reordering
+		for (int k = rand() % 3; k >= 0 && w; --k){
+			int raise = rand() % 2;
+			int moved = raise ? root->children.last != w : root->children.first != w;
+
+			root->dirty = 0;
+			if (raise){
+				tui_win_raise(w);
+			}
+			else{
+				tui_win_lower(w);
+			}
+			if (moved && !(root->dirty & TUI_DIRTY_LAYOUT)){
+				fprintf(stderr, "restacking a child did not mark its parent for layout\n");
+				return -1;
+			}
+			w = wins[rand() % *n];
+		}
+		w = NULL;
+		break;
+	default:
+		break;
+	}
+	if (w){
+		tui_win_set(w, TUI_SET_GRAVITY, gravities[rand() % (sizeof(gravities) / sizeof(*gravities))]);
+		tui_win_set(w, TUI_SET_WIDTH, rnd_size());
+		tui_win_set(w, TUI_SET_HEIGHT, rnd_size());
+	}
+	// the root only moves now and then, so most layouts only position the children that changed
+	if (rand() % 8 == 0){
+		root->pos.total = (tui_container){ 0, 20 + rand() % 200, 0, 20 + rand() % 200 };
+		tui_win_set(root, TUI_SET_PADDING, rand() % 3);
+		__tui_calcusablespace(root);
+	}
+
+	got_ret = tui_grav_calcchildren(root);
+	i = 0;
+	for (tui_window* child = root->children.first; child; child = child->next){
+		got[i++] = child->pos.total;
+	}
+	want_ret = ref_calcchildren(root);
+	if (got_ret != want_ret){
+		fprintf(stderr, "return values differ: %s vs %s\n", tui_strerr(got_ret), tui_strerr(want_ret));
+		return -1;
+	}
+	if (got_ret != TUI_OK){
+		return 0;
+	}
+	i = 0;
+	for (tui_window* child = root->children.first; child; child = child->next, ++i){
+		if (memcmp(&got[i], &child->pos.total, sizeof(got[i])) != 0){
+			fprintf(stderr, "child %zu (gravity %d, %dx%d) differs: [%d,%d]x[%d,%d] vs [%d,%d]x[%d,%d]\n",
+				i, child->gravity, child->width, child->height,
+				got[i].row_top, got[i].row_bot, got[i].col_left, got[i].col_right,
+				child->pos.total.row_top, child->pos.total.row_bot, child->pos.total.col_left, child->pos.total.col_right);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Raises and lowers children stacked against the left edge of the screen, and checks that tui_show() restacks them.
+ */
+static int check_restack(void){
+	tui_window* wins[3];
+	// where each child is in the stack, counting from the left edge
+	int want[][3] = {
+		{ 0, 1, 2 }, // as made
+		{ 2, 0, 1 }, // after raising the first
+		{ 2, 1, 0 }  // after lowering the last
+	};
+	int ret = 0;
+
+	tui_set_backend(tui_headless_backend());
+	tui_headless_resize(24, 80);
+	if (tui_win_make_n(stdwin, 3, wins) != TUI_OK){
+		fprintf(stderr, "out of memory\n");
+		return -1;
+	}
+	for (int i = 0; i < 3; ++i){
+		tui_win_set(wins[i], TUI_SET_GRAVITY, TUI_GRAV_LEFT);
+		tui_win_set(wins[i], TUI_SET_WIDTH, 10);
+		tui_win_set(wins[i], TUI_SET_HEIGHT, 5);
+	}
+
+	for (int step = 0; step < 3 && ret == 0; ++step){
+		if (step == 1){
+			tui_win_raise(wins[0]);
+		}
+		else if (step == 2){
+			tui_win_lower(wins[2]);
+		}
+		tui_show(stdwin);
+		for (int i = 0; i < 3; ++i){
+			int col = stdwin->pos.usable.col_left + want[step][i] * 11;
+			if (wins[i]->pos.total.col_left != col){
+				fprintf(stderr, "restack step %d: child %d starts at column %d instead of %d\n", step, i, wins[i]->pos.total.col_left, col);
+				ret = -1;
+			}
+		}
+	}
+
+	for (int i = 0; i < 3; ++i){
+		tui_win_free(wins[i]);
+	}
+	return ret;
+}
+
+static void throughput(size_t n){
+	tui_window root = { 0 };
+	tui_window** wins = malloc(n * sizeof(*wins));
+	double fast = 0;
+	double ref = 0;
+
+	root.pos.total = (tui_container){ 0, 999999999, 0, 999999999 };
+	root.pos.usable = root.pos.total;
+	if (!wins || tui_win_make_n(&root, n, wins) != TUI_OK){
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	for (size_t i = 0; i < n; ++i){
+		tui_win_set(wins[i], TUI_SET_GRAVITY, gravities[i % (sizeof(gravities) / sizeof(*gravities))]);
+		tui_win_set(wins[i], TUI_SET_WIDTH, 4);
+		tui_win_set(wins[i], TUI_SET_HEIGHT, 3);
+	}
+
+	for (int rep = 0; rep < REPS; ++rep){
+		double start;
+
+		__tui_cpos_reset(&root);
+		start = now_ns();
+		tui_grav_calcchildren(&root);
+		fast += now_ns() - start;
+
+		start = now_ns();
+		ref_calcchildren(&root);
+		ref += now_ns() - start;
+	}
+	printf("%7zu children: %6.1f ns/child, reference %6.1f ns/child\n", n, fast / REPS / n, ref / REPS / n);
+	free(wins);
+}
+
+/**
+ * Measures moving a child in the middle of the list in and out of a bucket whose other member is far below it.
+ */
+static void attach_cost(size_t n){
+	tui_window root = { 0 };
+	tui_window** wins = malloc(n * sizeof(*wins));
+	tui_window* mid;
+	double start;
+
+	root.pos.total = (tui_container){ 0, 999999999, 0, 999999999 };
+	root.pos.usable = root.pos.total;
+	if (!wins || tui_win_make_n(&root, n, wins) != TUI_OK){
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	tui_win_set(wins[0], TUI_SET_GRAVITY, TUI_GRAV_LEFT);
+	mid = wins[n / 2];
+
+	start = now_ns();
+	for (int rep = 0; rep < REPS * 100; ++rep){
+		tui_win_set(mid, TUI_SET_GRAVITY, TUI_GRAV_LEFT);
+		tui_win_set(mid, TUI_SET_GRAVITY, TUI_GRAV_CENTER);
+	}
+	printf("%7zu children: %6.1f ns to move a child in the middle into a bucket and out\n", n, (now_ns() - start) / (REPS * 100));
+	free(wins);
+}
+
+int main(int argc, char** argv){
+	long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : 200000;
+	tui_window root = { 0 };
+	tui_window* wins[MAX_CHILDREN];
+	size_t n = 0;
+	size_t sizes[] = { 100, 10000, 1000000 };
+
+	if (check_restack() != 0){
+		return 1;
+	}
+
+	srand(1);
+	for (long i = 0; i < iterations; ++i){
+		if (check(&root, wins, &n) != 0){
+			fprintf(stderr, "mismatch after %ld iterations\n", i);
+			return 1;
+		}
+	}
+	printf("%ld random layouts match the reference\n", iterations);
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i){
+		throughput(sizes[i]);
+	}
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i){
+		attach_cost(sizes[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+/** @file bench/bench_input.c
+ * @brief Measures the throughput of the input decoder on large input streams.
+ * Usage: bench_input [MiB of input, default 64]
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* const sequences[] = {
+	"\033[A", "\033[B", "\033[C", "\033[D",
+	"\033[H", "\033[F", "\033[5~", "\033[6~", "\033[3~",
+	"\033OP", "\033OQ", "\033[15~", "\033[24~",
+	"\033[1;5A", "\033[1;2D", "\033[3;3~",
+	"\033x", "\033[<0;12;34M"
+};
+
+static double now_s(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Fills a buffer with typed text interleaved with escape sequences.
+ * Roughly one in eight keys is an escape sequence.
+ */
+static size_t make_stream(unsigned char* buf, size_t len){
+	size_t pos = 0;
+
+	while (pos < len){
+		if (rand() % 8 == 0){
+			const char* seq = sequences[rand() % (sizeof(sequences) / sizeof(*sequences))];
+			size_t seq_len = strlen(seq);
+			if (pos + seq_len > len){
+				break;
+			}
+			memcpy(buf + pos, seq, seq_len);
+			pos += seq_len;
+		}
+		else{
+			buf[pos++] = ' ' + rand() % 95;
+		}
+	}
+	return pos;
+}
+
+static void run(const unsigned char* stream, size_t len, size_t max_chunk){
+	tui_keydecoder kd;
+	int keys[4096];
+	size_t total_keys = 0;
+	size_t pos = 0;
+	double start;
+	double elapsed;
+
+	tui_kd_init(&kd);
+	srand(1);
+	start = now_s();
+	while (pos < len){
+		size_t chunk = max_chunk == 1 ? 1 : 1 + rand() % max_chunk;
+		size_t n_keys;
+		if (chunk > len - pos){
+			chunk = len - pos;
+		}
+		while (chunk > 0){
+			size_t used = tui_kd_feed(&kd, stream + pos, chunk, keys, sizeof(keys) / sizeof(*keys), &n_keys);
+			pos += used;
+			chunk -= used;
+			total_keys += n_keys;
+		}
+	}
+	elapsed = now_s() - start;
+
+	printf("chunks of up to %5zu bytes: %8.1f MB/s, %7.1f Mkeys/s (%zu keys)\n",
+		max_chunk, len / elapsed / 1e6, total_keys / elapsed / 1e6, total_keys);
+}
+
+int main(int argc, char** argv){
+	size_t len = (argc > 1 ? (size_t)atol(argv[1]) : 64) << 20;
+	unsigned char* stream = malloc(len);
+
+	if (!stream){
+		perror("malloc");
+		return 1;
+	}
+
+	srand(42);
+	len = make_stream(stream, len);
+	printf("%zu MiB input stream\n", len >> 20);
+
+	run(stream, len, 1);
+	run(stream, len, 64);
+	run(stream, len, 4096);
+
+	free(stream);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/** @file bench/bench_layout.c
+ * @brief Measures how long laying out the window tree takes per window.
+ * Usage: bench_layout<br>
+ * In the wide and bushy trees the changed leaf is close to the root, so laying it out again has to cost a small part of a full layout.
+ * The bench exits with 1 if it does not.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "window.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define REPS (20)
+
+typedef struct tree{
+	tui_window root;
+	tui_window** wins;
+	size_t len;
+}tree;
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void tree_init(tree* t, size_t n){
+	t->root = (tui_window){ 0 };
+	t->root.pos.total = (tui_container){ 0, 999999999, 0, 999999999 };
+	t->root.pos.usable = t->root.pos.total;
+	t->wins = malloc(n * sizeof(*t->wins));
+	t->len = 0;
+	if (!t->wins){
+		perror("malloc");
+		exit(1);
+	}
+}
+
+static tui_window* add(tree* t, tui_window* parent, tui_gravity g, int width, int height){
+	tui_window* w;
+
+	if (tui_win_make(parent, &w) != TUI_OK){
+		fprintf(stderr, "tui_win_make failed\n");
+		exit(1);
+	}
+	tui_win_set(w, TUI_SET_GRAVITY, g);
+	tui_win_set(w, TUI_SET_WIDTH, width);
+	tui_win_set(w, TUI_SET_HEIGHT, height);
+	t->wins[t->len++] = w;
+	return w;
+}
+
+/* every window is a child of the root */
+static void build_wide(tree* t, size_t n){
+	tree_init(t, n);
+	for (size_t i = 0; i < n; ++i){
+		add(t, &t->root, TUI_GRAV_LEFT, 4, 3);
+	}
+}
+
+/* every window is the only child of the previous one */
+static void build_deep(tree* t, size_t n){
+	tui_window* parent;
+
+	tree_init(t, n);
+	parent = &t->root;
+	for (size_t i = 0; i < n; ++i){
+		parent = add(t, parent, TUI_GRAV_CENTER, TUI_MATCH_PARENT, TUI_MATCH_PARENT);
+	}
+}
+
+/* every window has up to 16 children, side by side */
+static void build_bushy(tree* t, size_t n){
+	int* widths = malloc(n * sizeof(*widths));
+
+	if (!widths){
+		perror("malloc");
+		exit(1);
+	}
+	tree_init(t, n);
+	add(t, &t->root, TUI_GRAV_CENTER, TUI_MATCH_PARENT, TUI_MATCH_PARENT);
+	widths[0] = t->root.pos.usable.col_right;
+	for (size_t i = 1; i < n; ++i){
+		size_t parent = (i - 1) / 16;
+		widths[i] = widths[parent] / 17;
+		add(t, t->wins[parent], TUI_GRAV_LEFT, widths[i], TUI_MATCH_PARENT);
+	}
+	free(widths);
+}
+
+/**
+ * @return False if the leaf is close to the root and laying it out again cost more than a tenth of a full layout.
+ */
+static bool run(const char* name, void (*build)(tree*, size_t), size_t n, bool shallow){
+	tree t;
+	double full = 0;
+	double leaf = 0;
+
+	build(&t, n);
+	if (tui_layout(&t.root) != TUI_OK){
+		fprintf(stderr, "%s: layout failed\n", name);
+		exit(1);
+	}
+
+	for (int rep = 0; rep < REPS; ++rep){
+		double start;
+		tui_window* w = t.wins[t.len - 1];
+
+		// everything
+		__tui_cpos_reset(&t.root);
+		__tui_win_dirty(&t.root, TUI_DIRTY_LAYOUT);
+		for (size_t i = 0; i < t.len; ++i){
+			__tui_cpos_reset(t.wins[i]);
+			__tui_win_dirty(t.wins[i], TUI_DIRTY_LAYOUT);
+		}
+		start = now_ns();
+		tui_layout(&t.root);
+		full += now_ns() - start;
+
+		// one leaf
+		tui_win_set(w, TUI_SET_HEIGHT, w->height == 3 ? 2 : 3);
+		start = now_ns();
+		tui_layout(&t.root);
+		leaf += now_ns() - start;
+	}
+
+	printf("%-6s %7zu windows: full layout %7.1f ns/window, one leaf changed %10.0f ns\n",
+		name, n, full / REPS / n, leaf / REPS);
+	// the windows are not freed. the process is about to exit
+	free(t.wins);
+	if (shallow && leaf * 10 > full){
+		fprintf(stderr, "%s: one leaf changed costs %.0f%% of a full layout\n", name, leaf * 100 / full);
+		return false;
+	}
+	return true;
+}
+
+int main(void){
+	size_t sizes[] = { 1000, 100000 };
+	bool ok = true;
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i){
+		ok &= run("wide", build_wide, sizes[i], true);
+		// the leaf is at the bottom of the whole tree, so every window is on its path
+		ok &= run("deep", build_deep, sizes[i], false);
+		ok &= run("bushy", build_bushy, sizes[i], true);
+	}
+	return ok ? 0 : 1;
+}
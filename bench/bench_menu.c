@@ -0,0 +1,109 @@
+/** @file bench/bench_menu.c
+ * @brief Measures how long a keystroke in a menu takes as the number of choices grows.
+ * Usage: bench_menu [keys]<br>
+ * Frames are drawn into the headless backend, so no terminal is needed.
+ * A keystroke's latency covers handling the key and showing the frame that results.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "window.h"
+#include "menu.h"
+#include "headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long max_rss_kb(void){
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
+
+static int cmp_double(const void* a, const void* b){
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/* up and down mostly, with the occasional page and jump, like someone looking for a host */
+static const int keys[] = {
+	KEY_DOWN, KEY_DOWN, KEY_DOWN, KEY_PGDOWN, KEY_DOWN, KEY_UP, KEY_PGDOWN, KEY_PGDOWN,
+	KEY_DOWN, KEY_PGUP, KEY_DOWN, KEY_DOWN, KEY_END, KEY_UP, KEY_PGUP, KEY_HOME
+};
+
+static void run(size_t n, int n_keys){
+	char* text = malloc(n * 32);
+	const char** choices = malloc(n * sizeof(*choices));
+	double* lat = malloc(n_keys * sizeof(*lat));
+	tui_window* win;
+	tui_win_config cfg = { .width = TUI_MATCH_PARENT, .height = TUI_MATCH_PARENT };
+	tui_menu menu;
+	double t;
+	double init;
+	long rss;
+
+	if (!text || !choices || !lat){
+		perror("malloc");
+		exit(1);
+	}
+	for (size_t i = 0; i < n; ++i){
+		snprintf(text + i * 32, 32, "host-%07zu.example.com", i);
+		choices[i] = text + i * 32;
+	}
+	if (tui_win_make(stdwin, &win) != TUI_OK || tui_win_apply(win, &cfg, TUI_CFG_WIDTH | TUI_CFG_HEIGHT) != TUI_OK){
+		fprintf(stderr, "could not make the window\n");
+		exit(1);
+	}
+
+	rss = max_rss_kb();
+	t = now_ns();
+	if (tui_menu_init(&menu, win, choices, n, TUI_MENU_CENTER) != TUI_OK){
+		fprintf(stderr, "tui_menu_init failed\n");
+		exit(1);
+	}
+	tui_show(stdwin);
+	init = now_ns() - t;
+
+	for (int i = 0; i < n_keys; ++i){
+		t = now_ns();
+		tui_menu_key(&menu, keys[i % (sizeof(keys) / sizeof(*keys))]);
+		tui_show(stdwin);
+		lat[i] = now_ns() - t;
+	}
+
+	qsort(lat, n_keys, sizeof(*lat), cmp_double);
+	printf("%9zu choices  first frame %9.2fus  key p50 %7.2fus  p99 %7.2fus  rss +%ldKiB\n",
+		n, init / 1e3, lat[n_keys / 2] / 1e3, lat[(size_t)(n_keys * 0.99)] / 1e3, max_rss_kb() - rss);
+
+	tui_menu_free(&menu);
+	tui_win_free(win);
+	free(lat);
+	free(choices);
+	free(text);
+}
+
+int main(int argc, char** argv){
+	int n_keys = argc > 1 ? atoi(argv[1]) : 20000;
+
+	if (n_keys <= 0){
+		fprintf(stderr, "Usage: %s [keys]\n", argv[0]);
+		return 1;
+	}
+
+	tui_set_backend(tui_headless_backend());
+	tui_headless_resize(50, 160);
+	for (size_t n = 1000; n <= 10000000; n *= 10){
+		run(n, n_keys);
+	}
+	return 0;
+}
@@ -0,0 +1,351 @@
+/** @file bench/bench_render.c
+ * @brief Measures what rendering costs end to end, from drawing a frame to the terminal receiving it.
+ * Usage: bench_render [frames]<br>
+ * Link with -Wl,--wrap=write,--wrap=writev -lutil -lpthread so the syscalls can be counted.<br>
+ * Output goes through the POSIX backend into a pseudo-terminal, and a reader thread drains the other end.
+ * A frame's latency lasts until every byte of it was read.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "window.h"
+#include "backend.h"
+#include "framebuffer.h"
+#include <errno.h>
+#include <pthread.h>
+#include <pty.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define ROWS  (50)
+#define COLS  (160)
+#define DEPTH (20)
+#define TABLE_ROWS (1000)
+
+ssize_t __real_write(int fd, const void* buf, size_t len);
+ssize_t __real_writev(int fd, const struct iovec* iov, int iovcnt);
+
+static size_t n_syscalls;
+static size_t n_written;
+
+ssize_t __wrap_write(int fd, const void* buf, size_t len){
+	ssize_t n = __real_write(fd, buf, len);
+
+	if (fd == STDOUT_FILENO){
+		n_syscalls++;
+		n_written += n > 0 ? (size_t)n : 0;
+	}
+	return n;
+}
+
+ssize_t __wrap_writev(int fd, const struct iovec* iov, int iovcnt){
+	ssize_t n = __real_writev(fd, iov, iovcnt);
+
+	if (fd == STDOUT_FILENO){
+		n_syscalls++;
+		n_written += n > 0 ? (size_t)n : 0;
+	}
+	return n;
+}
+
+static int master = -1;
+static atomic_size_t n_read;
+static FILE* report;
+
+static void* reader(void* arg){
+	char buf[65536];
+
+	(void)arg;
+	for (;;){
+		ssize_t n = read(master, buf, sizeof(buf));
+		if (n < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			return NULL;
+		}
+		if (n == 0){
+			return NULL;
+		}
+		atomic_fetch_add(&n_read, (size_t)n);
+	}
+}
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Waits until the reader has seen everything that was written.
+ */
+static void drain(void){
+	while (atomic_load(&n_read) < n_written){
+		sched_yield();
+	}
+}
+
+static void set_size(int rows, int cols){
+	struct winsize ws = { 0 };
+
+	ws.ws_row = rows;
+	ws.ws_col = cols;
+	if (ioctl(master, TIOCSWINSZ, &ws) != 0){
+		perror("TIOCSWINSZ");
+		exit(1);
+	}
+	// the pseudo-terminal is not our controlling terminal, so nobody else sends this
+	raise(SIGWINCH);
+}
+
+static int cmp_double(const void* a, const void* b){
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+typedef struct scenario{
+	const char* name;
+	void (*setup)(void);
+	void (*frame)(int i);
+	void (*teardown)(void);
+}scenario;
+
+static void run(const scenario* s, int frames){
+	double* lat = malloc(frames * sizeof(*lat));
+	size_t syscalls_start;
+	size_t written_start;
+	double start;
+	double total;
+
+	if (!lat){
+		perror("malloc");
+		exit(1);
+	}
+
+	s->setup();
+	drain();
+	syscalls_start = n_syscalls;
+	written_start = n_written;
+	start = now_ns();
+	for (int i = 0; i < frames; ++i){
+		double t = now_ns();
+		s->frame(i);
+		drain();
+		lat[i] = now_ns() - t;
+	}
+	total = now_ns() - start;
+	s->teardown();
+
+	qsort(lat, frames, sizeof(*lat), cmp_double);
+	fprintf(report, "%-16s %10.0f frames/s %10.1f bytes/frame %6.2f syscalls/frame  p50 %8.2fus  p99 %8.2fus\n",
+		s->name,
+		frames / (total / 1e9),
+		(double)(n_written - written_start) / frames,
+		(double)(n_syscalls - syscalls_start) / frames,
+		lat[frames / 2] / 1e3,
+		lat[(size_t)(frames * 0.99)] / 1e3);
+	free(lat);
+}
+
+static tui_framebuffer fb;
+
+static void fb_setup(void){
+	if (tui_fb_resize(&fb, tui_getrows(), tui_getcols()) != 0){
+		perror("tui_fb_resize");
+		exit(1);
+	}
+	tui_fb_flush(&fb);
+}
+
+static void fb_teardown(void){
+	tui_fb_free(&fb);
+}
+
+static const tui_style colors[] = {
+	TUI_FG_RED, TUI_FG_GREEN, TUI_FG_YELLOW, TUI_FG_BLUE,
+	TUI_FG_MAGENTA, TUI_FG_CYAN, TUI_FG_WHITE | TUI_BG_BLUE, TUI_FG_BLACK | TUI_BG_WHITE
+};
+
+static void full_frame(int i){
+	char glyph[2] = { 'a' + i % 26, '\0' };
+	tui_style attr = colors[i % 8];
+
+	for (int row = 0; row < fb.rows; ++row){
+		for (int col = 0; col < fb.cols; ++col){
+			tui_fb_putglyph(&fb, row, col, glyph, attr);
+		}
+	}
+	tui_fb_flush(&fb);
+}
+
+static void cell_frame(int i){
+	char glyph[2] = { 'a' + i % 26, '\0' };
+
+	tui_fb_putglyph(&fb, i % fb.rows, i % fb.cols, glyph, colors[i % 8]);
+	tui_fb_flush(&fb);
+}
+
+static void table_frame(int i){
+	char line[64];
+
+	// every visible row moves up by one, like scrolling through a long colored listing
+	for (int row = 0; row < fb.rows; ++row){
+		int entry = (i + row) % TABLE_ROWS;
+		snprintf(line, sizeof(line), " %05d | %-20s | %8d | %s", entry, "some value", entry * 37, entry % 3 ? "ok" : "failed");
+		tui_fb_clearrect(&fb, row, 0, row, fb.cols - 1);
+		tui_fb_puts(&fb, row, 0, line, colors[entry % 8]);
+	}
+	tui_fb_flush(&fb);
+}
+
+static void dashboard_setup(void){
+	char line[64];
+
+	fb_setup();
+	for (int row = 0; row < fb.rows; ++row){
+		snprintf(line, sizeof(line), "%-12s %8d %8d %8d", "counter", row, row * 3, row * 7);
+		tui_fb_puts(&fb, row, 0, line, colors[row % 8]);
+	}
+	tui_fb_flush(&fb);
+}
+
+static void dashboard_frame(int i){
+	char num[16];
+
+	// a few counters in every row tick over, like a monitoring dashboard
+	for (int row = 0; row < fb.rows; ++row){
+		snprintf(num, sizeof(num), "%8d", row * 3 + i);
+		tui_fb_puts(&fb, row, 22, num, colors[row % 8]);
+		if ((row + i) % 4 == 0){
+			snprintf(num, sizeof(num), "%8d", row * 7 + i / 4);
+			tui_fb_puts(&fb, row, 31, num, colors[row % 8]);
+		}
+	}
+	tui_fb_flush(&fb);
+}
+
+static tui_window* chain[DEPTH];
+
+static void deep_setup(void){
+	tui_win_config cfg = { .width = TUI_MATCH_PARENT, .height = TUI_MATCH_PARENT };
+	tui_window* parent = stdwin;
+
+	for (int i = 0; i < DEPTH; ++i){
+		if (tui_win_make(parent, &chain[i]) != TUI_OK ||
+				tui_win_apply(chain[i], &cfg, TUI_CFG_WIDTH | TUI_CFG_HEIGHT) != TUI_OK){
+			fprintf(stderr, "could not make the window tree\n");
+			exit(1);
+		}
+		parent = chain[i];
+	}
+	tui_show(stdwin);
+}
+
+static void deep_frame(int i){
+	// the innermost window changes, so the whole chain above it is walked again
+	tui_win_set(chain[DEPTH - 1], TUI_SET_BORDER, i % 2 ? TUI_BORDER_NONE : TUI_BORDER_SINGLE);
+	tui_show(stdwin);
+}
+
+static void deep_teardown(void){
+	tui_win_free(chain[0]);
+	tui_show(stdwin);
+}
+
+static tui_window* panes[4];
+
+static void resize_setup(void){
+	static const tui_gravity grav[4] = { TUI_GRAV_LEFT, TUI_GRAV_RIGHT, TUI_GRAV_TOP, TUI_GRAV_BOT };
+	tui_win_config cfg = { .width = 20, .height = 8 };
+
+	for (int i = 0; i < 4; ++i){
+		cfg.gravity = grav[i];
+		if (tui_win_make(stdwin, &panes[i]) != TUI_OK ||
+				tui_win_apply(panes[i], &cfg, TUI_CFG_GRAVITY | TUI_CFG_WIDTH | TUI_CFG_HEIGHT) != TUI_OK){
+			fprintf(stderr, "could not make the windows\n");
+			exit(1);
+		}
+	}
+	tui_show(stdwin);
+}
+
+static void resize_frame(int i){
+	set_size(ROWS - i % 10, COLS - i % 40);
+	tui_resized();
+	tui_show(stdwin);
+}
+
+static void resize_teardown(void){
+	for (int i = 0; i < 4; ++i){
+		tui_win_free(panes[i]);
+	}
+	set_size(ROWS, COLS);
+	tui_resized();
+	tui_show(stdwin);
+}
+
+static const scenario scenarios[] = {
+	{ "full redraw",  fb_setup,        full_frame,      fb_teardown },
+	{ "single cell",  fb_setup,        cell_frame,      fb_teardown },
+	{ "table scroll", fb_setup,        table_frame,     fb_teardown },
+	{ "dashboard",    dashboard_setup, dashboard_frame, fb_teardown },
+	{ "deep tree",    deep_setup,      deep_frame,      deep_teardown },
+	{ "resize storm", resize_setup,    resize_frame,    resize_teardown }
+};
+
+int main(int argc, char** argv){
+	int frames = argc > 1 ? atoi(argv[1]) : 2000;
+	struct winsize ws = { 0 };
+	struct termios raw;
+	pthread_t thread;
+	int slave;
+
+	if (frames <= 0){
+		fprintf(stderr, "Usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+
+	ws.ws_row = ROWS;
+	ws.ws_col = COLS;
+	if (openpty(&master, &slave, NULL, NULL, &ws) != 0){
+		perror("openpty");
+		return 1;
+	}
+	// count the bytes we send, not what the line discipline turns them into
+	tcgetattr(slave, &raw);
+	cfmakeraw(&raw);
+	tcsetattr(slave, TCSANOW, &raw);
+
+	report = fdopen(dup(STDOUT_FILENO), "w");
+	if (!report || dup2(slave, STDOUT_FILENO) < 0){
+		perror("dup2");
+		return 1;
+	}
+	close(slave);
+
+	if (pthread_create(&thread, NULL, reader, NULL) != 0){
+		perror("pthread_create");
+		return 1;
+	}
+
+	fprintf(report, "%dx%d pseudo-terminal, %d frames per scenario\n", ROWS, COLS, frames);
+	for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); ++i){
+		run(&scenarios[i], frames);
+	}
+	fclose(report);
+	return 0;
+}
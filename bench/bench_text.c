@@ -0,0 +1,108 @@
+/** @file bench/bench_text.c
+ * @brief Measures how long a text block takes to draw as its text grows, with and without its line breaks cached.
+ * Usage: bench_text [frames]<br>
+ * Frames are drawn into the headless backend, so no terminal is needed.
+ * "wrap" frames follow a window whose width changes every frame, so the text is broken into lines every time.
+ * "cached" frames redraw the window at the same width.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "window.h"
+#include "text.h"
+#include "headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const char* const words[] = {
+	"the", "terminal", "only", "redraws", "cells", "that", "changed", "since", "last", "frame,",
+	"so", "a", "paragraph", "of", "text", "costs", "little", "once", "its", "lines", "are", "known."
+};
+
+/**
+ * Makes a text of roughly len bytes in paragraphs of a few hundred bytes.
+ */
+static char* make_text(size_t len){
+	char* text = malloc(len + 32);
+	size_t n = 0;
+
+	if (!text){
+		perror("malloc");
+		exit(1);
+	}
+	while (n < len){
+		const char* w = words[rand() % (sizeof(words) / sizeof(*words))];
+		size_t wl = strlen(w);
+
+		memcpy(text + n, w, wl);
+		n += wl;
+		text[n++] = rand() % 40 == 0 ? '\n' : ' ';
+	}
+	text[n] = '\0';
+	return text;
+}
+
+static void run(size_t len, int frames){
+	char* str = make_text(len);
+	tui_window* win;
+	tui_win_config cfg = { .width = 80, .height = TUI_MATCH_PARENT };
+	tui_text text;
+	double t;
+	double wrap;
+	double cached;
+
+	if (tui_win_make(stdwin, &win) != TUI_OK || tui_win_apply(win, &cfg, TUI_CFG_WIDTH | TUI_CFG_HEIGHT) != TUI_OK){
+		fprintf(stderr, "could not make the window\n");
+		exit(1);
+	}
+	tui_text_init(&text, win, str, SIZE_MAX, TUI_TEXT_CENTER);
+	tui_show(stdwin);
+
+	t = now_ns();
+	for (int i = 0; i < frames; ++i){
+		cfg.width = 60 + i % 40;
+		tui_win_apply(win, &cfg, TUI_CFG_WIDTH);
+		tui_show(stdwin);
+	}
+	wrap = (now_ns() - t) / frames;
+
+	t = now_ns();
+	for (int i = 0; i < frames; ++i){
+		tui_win_invalidate(win);
+		tui_show(stdwin);
+	}
+	cached = (now_ns() - t) / frames;
+
+	printf("%9zu bytes  %7zu lines  wrap %10.2fus/frame  cached %7.2fus/frame\n", len, text.n_lines, wrap / 1e3, cached / 1e3);
+
+	tui_text_free(&text);
+	tui_win_free(win);
+	free(str);
+}
+
+int main(int argc, char** argv){
+	int frames = argc > 1 ? atoi(argv[1]) : 200;
+
+	if (frames <= 0){
+		fprintf(stderr, "Usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+
+	tui_set_backend(tui_headless_backend());
+	tui_headless_resize(50, 160);
+	srand(1);
+	for (size_t len = 1000; len <= 10000000; len *= 10){
+		run(len, frames);
+	}
+	return 0;
+}
@@ -0,0 +1,383 @@
+/** @file event.c
+ * @brief Event loop that waits on input, resizes, timers and other file descriptors together.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "event.h"
+
+#include "backend.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define TUI_SRC_INPUT  (0)
+#define TUI_SRC_RESIZE (1)
+#define TUI_SRC_FD     (2)
+#define TUI_SRC_TIMER  (3)
+
+#define TUI_MAX_EVENTS (32)
+
+/**
+ * @brief Something the loop waits on.
+ * epoll hands these back to us, so they stay at the same address until they are freed.
+ */
+typedef struct tui_source{
+	int type;
+	int fd;
+	int id;
+	bool repeat;
+	bool deleted;
+	union{
+		tui_fd_cb fd;
+		tui_timer_cb timer;
+	}cb;
+	void* data;
+	struct tui_source* next;
+}tui_source;
+
+static struct tui_loop{
+	int epfd;
+	bool running;
+	bool dirty;
+	int timer_id_next;
+
+	/**
+	 * @brief Every source that is still registered.
+	 */
+	tui_source* sources;
+
+	/**
+	 * @brief Sources deleted while handling events.
+	 * They are freed once epoll can no longer hand them back to us.
+	 */
+	tui_source* graveyard;
+
+	tui_key_cb key_cb;
+	void* key_data;
+	tui_resize_cb resize_cb;
+	void* resize_data;
+}loop = { -1, false, false, 1, NULL, NULL, NULL, NULL, NULL, NULL };
+
+static int __tui_loop_init(void){
+	if (loop.epfd >= 0){
+		return TUI_OK;
+	}
+	loop.epfd = epoll_create1(EPOLL_CLOEXEC);
+	return loop.epfd >= 0 ? TUI_OK : TUI_ENOMEM;
+}
+
+static uint32_t __tui_epoll_events(int events){
+	return (events & TUI_EV_READ ? EPOLLIN : 0) | (events & TUI_EV_WRITE ? EPOLLOUT : 0);
+}
+
+static int __tui_src_add(int type, int fd, uint32_t events, tui_source** out){
+	struct epoll_event ev;
+	tui_source* src;
+	int ret;
+
+	if ((ret = __tui_loop_init()) != TUI_OK){
+		return ret;
+	}
+
+	src = calloc(1, sizeof(*src));
+	if (!src){
+		return TUI_ENOMEM;
+	}
+	src->type = type;
+	src->fd = fd;
+
+	ev.events = events;
+	ev.data.ptr = src;
+	if (epoll_ctl(loop.epfd, EPOLL_CTL_ADD, fd, &ev) != 0){
+		free(src);
+		return errno == ENOMEM ? TUI_ENOMEM : TUI_EINVAL;
+	}
+
+	src->next = loop.sources;
+	loop.sources = src;
+	*out = src;
+	return TUI_OK;
+}
+
+static void __tui_src_del(tui_source* src){
+	tui_source** pp = &loop.sources;
+
+	while (*pp != src){
+		pp = &(*pp)->next;
+	}
+	*pp = src->next;
+
+	epoll_ctl(loop.epfd, EPOLL_CTL_DEL, src->fd, NULL);
+	if (src->type == TUI_SRC_TIMER){
+		close(src->fd);
+	}
+
+	src->deleted = true;
+	src->next = loop.graveyard;
+	loop.graveyard = src;
+}
+
+static tui_source* __tui_src_find(int type, int key){
+	for (tui_source* src = loop.sources; src; src = src->next){
+		if (src->type == type && (type == TUI_SRC_TIMER ? src->id : src->fd) == key){
+			return src;
+		}
+	}
+	return NULL;
+}
+
+static void __tui_src_bury(void){
+	while (loop.graveyard){
+		tui_source* next = loop.graveyard->next;
+		free(loop.graveyard);
+		loop.graveyard = next;
+	}
+}
+
+void tui_on_key(tui_key_cb cb, void* data){
+	loop.key_cb = cb;
+	loop.key_data = data;
+}
+
+void tui_on_resize(tui_resize_cb cb, void* data){
+	loop.resize_cb = cb;
+	loop.resize_data = data;
+}
+
+int tui_add_fd(int fd, int events, tui_fd_cb cb, void* data){
+	tui_source* src;
+	int ret;
+
+	if (__tui_src_find(TUI_SRC_FD, fd)){
+		return TUI_EINVAL;
+	}
+	if ((ret = __tui_src_add(TUI_SRC_FD, fd, __tui_epoll_events(events), &src)) != TUI_OK){
+		return ret;
+	}
+	src->cb.fd = cb;
+	src->data = data;
+	return TUI_OK;
+}
+
+int tui_del_fd(int fd){
+	tui_source* src = __tui_src_find(TUI_SRC_FD, fd);
+
+	if (!src){
+		return TUI_EINVAL;
+	}
+	__tui_src_del(src);
+	return TUI_OK;
+}
+
+int tui_add_timer(int interval_ms, int repeat, tui_timer_cb cb, void* data, int* out){
+	struct itimerspec its;
+	tui_source* src;
+	int fd;
+	int ret;
+
+	if (interval_ms <= 0){
+		return TUI_EINVAL;
+	}
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0){
+		return TUI_ENOMEM;
+	}
+	its.it_value.tv_sec = interval_ms / 1000;
+	its.it_value.tv_nsec = (long)(interval_ms % 1000) * 1000000;
+	its.it_interval = repeat ? its.it_value : (struct timespec){ 0, 0 };
+	if (timerfd_settime(fd, 0, &its, NULL) != 0){
+		close(fd);
+		return TUI_EINVAL;
+	}
+
+	if ((ret = __tui_src_add(TUI_SRC_TIMER, fd, EPOLLIN, &src)) != TUI_OK){
+		close(fd);
+		return ret;
+	}
+	src->id = loop.timer_id_next++;
+	src->repeat = repeat;
+	src->cb.timer = cb;
+	src->data = data;
+
+	if (out){
+		*out = src->id;
+	}
+	return TUI_OK;
+}
+
+int tui_del_timer(int timer_id){
+	tui_source* src = __tui_src_find(TUI_SRC_TIMER, timer_id);
+
+	if (!src){
+		return TUI_EINVAL;
+	}
+	__tui_src_del(src);
+	return TUI_OK;
+}
+
+void tui_redraw(void){
+	loop.dirty = true;
+}
+
+void tui_quit(void){
+	loop.running = false;
+}
+
+static void __tui_handle_input(tui_source* src){
+	int keys[256];
+	int n;
+
+	while ((n = tui_getkeys(keys, sizeof(keys) / sizeof(*keys))) > 0){
+		for (int i = 0; i < n; ++i){
+			if (loop.key_cb){
+				loop.key_cb(keys[i], loop.key_data);
+			}
+		}
+		if ((size_t)n < sizeof(keys) / sizeof(*keys)){
+			return;
+		}
+	}
+
+	if (n < 0){
+		// the input ended. it would stay readable forever, so stop watching it
+		if (src){
+			__tui_src_del(src);
+		}
+		if (loop.key_cb){
+			loop.key_cb(EOF, loop.key_data);
+		}
+	}
+}
+
+static void __tui_handle_resize(void){
+	if (!tui_resized()){
+		return;
+	}
+	if (loop.resize_cb){
+		loop.resize_cb(tui_getrows(), tui_getcols(), loop.resize_data);
+	}
+	loop.dirty = true;
+}
+
+static void __tui_handle_timer(tui_source* src){
+	uint64_t expirations;
+
+	// the expiration count is read to rearm the file descriptor. coalesced expirations run the callback once
+	if (read(src->fd, &expirations, sizeof(expirations)) != sizeof(expirations)){
+		return;
+	}
+	if (!src->repeat){
+		__tui_src_del(src);
+	}
+	src->cb.timer(src->id, src->data);
+}
+
+static void __tui_dispatch(struct epoll_event* ev){
+	tui_source* src = ev->data.ptr;
+	int events = 0;
+
+	// an earlier callback in the same batch may have deleted this source
+	if (src->deleted){
+		return;
+	}
+
+	switch (src->type){
+	case TUI_SRC_INPUT:
+		__tui_handle_input(src);
+		break;
+	case TUI_SRC_RESIZE:
+		__tui_handle_resize();
+		break;
+	case TUI_SRC_TIMER:
+		__tui_handle_timer(src);
+		break;
+	case TUI_SRC_FD:
+		if (ev->events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+			events |= TUI_EV_READ;
+		}
+		if (ev->events & EPOLLOUT){
+			events |= TUI_EV_WRITE;
+		}
+		src->cb.fd(src->fd, events, src->data);
+		break;
+	}
+}
+
+int tui_run(tui_window* win){
+	struct epoll_event events[TUI_MAX_EVENTS];
+	tui_source* input = NULL;
+	tui_source* resize = NULL;
+	int ret;
+
+	if ((ret = __tui_loop_init()) != TUI_OK){
+		return ret;
+	}
+	if (tui_input_begin() != 0){
+		return TUI_EIO;
+	}
+	if ((ret = __tui_src_add(TUI_SRC_INPUT, STDIN_FILENO, EPOLLIN, &input)) != TUI_OK){
+		tui_input_end();
+		return ret;
+	}
+	if (tui_resize_fd() >= 0 && (ret = __tui_src_add(TUI_SRC_RESIZE, tui_resize_fd(), EPOLLIN, &resize)) != TUI_OK){
+		__tui_src_del(input);
+		__tui_src_bury();
+		tui_input_end();
+		return ret;
+	}
+
+	loop.running = true;
+	loop.dirty = true;
+	while (loop.running){
+		int timeout;
+		int n;
+
+		if (loop.dirty || win->dirty){
+			loop.dirty = false;
+			if ((ret = tui_show(win)) != TUI_OK){
+				break;
+			}
+		}
+
+		timeout = tui_input_timeout();
+		n = epoll_wait(loop.epfd, events, TUI_MAX_EVENTS, timeout);
+		if (n < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			ret = TUI_EIO;
+			break;
+		}
+
+		for (int i = 0; i < n; ++i){
+			__tui_dispatch(&events[i]);
+		}
+		// a partial escape sequence timed out
+		if (n == 0 && timeout >= 0 && input){
+			__tui_handle_input(input);
+		}
+		if (input && input->deleted){
+			input = NULL;
+		}
+		__tui_src_bury();
+	}
+
+	if (input){
+		__tui_src_del(input);
+	}
+	if (resize){
+		__tui_src_del(resize);
+	}
+	__tui_src_bury();
+	tui_input_end();
+	return ret;
+}
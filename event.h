@@ -0,0 +1,129 @@
+/** @file event.h
+ * @brief Event loop that waits on input, resizes, timers and other file descriptors together.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_EVENT_H
+#define __TUI_EVENT_H
+
+#include "attribute.h"
+#include "window/window.h"
+#include <stdint.h>
+
+#define TUI_EV_READ  (1 << 0) /**< Wake up when the file descriptor is readable. */
+#define TUI_EV_WRITE (1 << 1) /**< Wake up when the file descriptor is writable. */
+
+/**
+ * @brief Called with every key read while the loop runs.
+ * The key is the same as what tui_getch() returns, or EOF once the input ends.
+ */
+typedef void (*tui_key_cb)(int key, void* data);
+
+/**
+ * @brief Called after the terminal is resized, before the screen is redrawn.
+ */
+typedef void (*tui_resize_cb)(int rows, int cols, void* data);
+
+/**
+ * @brief Called when a file descriptor added with tui_add_fd() is ready.
+ * events is a combination of TUI_EV_READ and TUI_EV_WRITE.
+ */
+typedef void (*tui_fd_cb)(int fd, int events, void* data);
+
+/**
+ * @brief Called when a timer added with tui_add_timer() expires.
+ */
+typedef void (*tui_timer_cb)(int timer_id, void* data);
+
+/**
+ * Sets the function that receives keys.
+ * Only one can be set at a time.
+ *
+ * @param cb The callback, or NULL to ignore keys.
+ * @param data Passed to the callback.
+ */
+void tui_on_key(tui_key_cb cb, void* data);
+
+/**
+ * Sets the function that is told about resizes.
+ * The screen is redrawn after a resize whether or not a callback is set.
+ *
+ * @param cb The callback, or NULL.
+ * @param data Passed to the callback.
+ */
+void tui_on_resize(tui_resize_cb cb, void* data);
+
+/**
+ * Watches a file descriptor from the event loop.
+ *
+ * @param fd The file descriptor. It should be non-blocking.
+ * @param events A combination of TUI_EV_READ and TUI_EV_WRITE.
+ * @param cb Called when the file descriptor is ready.
+ * @param data Passed to the callback.
+ *
+ * @return TUI_OK on success, TUI_ENOMEM if out of memory, or TUI_EINVAL if the file descriptor cannot be watched.
+ */
+int tui_add_fd(int fd, int events, tui_fd_cb cb, void* data);
+
+/**
+ * Stops watching a file descriptor.
+ * This is safe to call from any callback, including the file descriptor's own.
+ *
+ * @param fd The file descriptor.
+ *
+ * @return TUI_OK on success, or TUI_EINVAL if the file descriptor is not watched.
+ */
+int tui_del_fd(int fd);
+
+/**
+ * Starts a timer.
+ *
+ * @param interval_ms How long until the timer expires in milliseconds.
+ * @param repeat Nonzero to expire again every interval_ms until the timer is deleted.
+ * Zero to expire once and delete the timer automatically.
+ * @param cb Called when the timer expires.
+ * @param data Passed to the callback.
+ * @param out Set to the timer's id. This may be NULL.
+ *
+ * @return TUI_OK on success, TUI_ENOMEM if out of memory, or TUI_EINVAL if interval_ms is not positive.
+ */
+int tui_add_timer(int interval_ms, int repeat, tui_timer_cb cb, void* data, int* out);
+
+/**
+ * Stops a timer.
+ * This is safe to call from any callback, including the timer's own.
+ *
+ * @param timer_id The id given by tui_add_timer().
+ *
+ * @return TUI_OK on success, or TUI_EINVAL if there is no such timer.
+ */
+int tui_del_timer(int timer_id);
+
+/**
+ * Requests that the screen is redrawn once the current events are handled.
+ * Any number of requests before then result in one redraw.
+ */
+void tui_redraw(void);
+
+/**
+ * Shows a window and handles events until tui_quit() is called.
+ * The window is redrawn only after tui_redraw(), a resize, or a change that made a window dirty,
+ * and the process sleeps while there is nothing to do.<br>
+ * Input is read in an input session for the duration of the loop.
+ * Once the input ends, the key callback gets EOF and input is no longer watched.
+ *
+ * @param win The window to show, usually stdwin.
+ *
+ * @return TUI_OK after tui_quit(), or an error code if the loop or a redraw failed.
+ */
+int tui_run(tui_window* win);
+
+/**
+ * Makes tui_run() return once the current events are handled.
+ */
+void tui_quit(void);
+
+#endif
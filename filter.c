@@ -0,0 +1,519 @@
+/** @file filter.c
+ * @brief Fuzzy filtering of a large list of choices on a pool of worker threads.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ * A search splits its candidates into chunks that the workers take one at a time.
+ * Each worker keeps the best matches of its chunk and merges them into the shared top k when the chunk is done,
+ * which is also when the caller is told that there are new results.<br>
+ * The matches of every chunk are written to that chunk's slice of an output buffer, in the order of the candidates.
+ * Once the last chunk is done the slices are packed together, and the list becomes the candidates of the next search
+ * if its query extends this one.
+ */
+
+#include "filter.h"
+
+#include "window/window.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* how many candidates a worker scores at a time before reporting what it found */
+#define TUI_FILTER_CHUNK (8192)
+
+/* how often a worker checks if its search was cancelled. must divide TUI_FILTER_CHUNK */
+#define TUI_FILTER_CANCEL_CHECK (1024)
+
+#define TUI_SCORE_MATCH       (16) /**< Every character of the query. */
+#define TUI_SCORE_CONSECUTIVE (24) /**< A character right after the previous one. */
+#define TUI_SCORE_BOUNDARY    (16) /**< A character at the start of the choice or of a word. */
+
+typedef struct tui_match{
+	int32_t score;
+	uint32_t index;
+}tui_match;
+
+struct tui_filter_worker{
+	struct tui_filter* f;
+	pthread_t thread;
+
+	/**
+	 * @brief The best k matches of the chunk the worker is on, as a heap.
+	 */
+	tui_match* top;
+	size_t top_len;
+};
+
+struct tui_filter{
+	const char* const* choices;
+	size_t len;
+	size_t k;
+
+	struct tui_filter_worker* workers;
+	int n_workers;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work; /**< Signaled when there are chunks to take, or the workers should quit. */
+	pthread_cond_t idle; /**< Signaled when the last busy worker puts its chunk down. */
+	int busy;
+	bool quit;
+
+	/**
+	 * @brief Bumped by every query. A worker on a chunk of an older generation drops it.
+	 * This is the only field that is read without holding the lock.
+	 */
+	atomic_uint gen;
+
+	/**
+	 * @brief The search in progress. It only changes while no worker is busy.
+	 */
+	char* query;
+	size_t query_cap;
+	const uint32_t* cand; /**< The choices to search, or NULL to search all of them. */
+	size_t n_cand;
+	int out_buf;          /**< Which of buf the matches go into. */
+	size_t* chunk_len;    /**< How many matches each chunk found. */
+	size_t n_chunks;
+	size_t next_chunk;
+	size_t chunks_done;
+	size_t matched;
+	bool done;
+
+	/**
+	 * @brief The best k matches of the search in progress, as a heap with the worst at the root.
+	 */
+	tui_match* top;
+	size_t top_len;
+
+	/**
+	 * @brief Every match of the last search that finished is in buf[base], or base is -1.
+	 * The other buffer takes the matches of the search in progress.
+	 */
+	uint32_t* buf[2];
+	int base;
+	size_t base_len;
+	char* base_query;
+	size_t base_query_cap;
+
+	/**
+	 * @brief Readable when there are results the caller did not get yet.
+	 */
+	int pipe[2];
+	bool notified;
+};
+
+static TUI_INLINE unsigned char __tui_lower(unsigned char c){
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+static TUI_INLINE bool __tui_is_word(unsigned char c){
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+/**
+ * Scores a choice against a lowercase query.
+ * Each character of the query matches the first character after the previous match that is equal to it.
+ *
+ * @return The score, or -1 if the choice doesn't match.
+ */
+static int32_t __tui_filter_score(const char* choice, const char* query){
+	const unsigned char* s = (const unsigned char*)choice;
+	const unsigned char* q = (const unsigned char*)query;
+	int32_t score = 0;
+	size_t next = SIZE_MAX;
+
+	if (*q == '\0'){
+		return 0;
+	}
+	for (size_t i = 0; s[i] != '\0'; ++i){
+		if (__tui_lower(s[i]) != *q){
+			continue;
+		}
+		score += TUI_SCORE_MATCH;
+		if (i == next){
+			score += TUI_SCORE_CONSECUTIVE;
+		}
+		if (i == 0 || !__tui_is_word(s[i - 1])){
+			score += TUI_SCORE_BOUNDARY;
+		}
+		next = i + 1;
+		if (*++q == '\0'){
+			return score;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Checks if a match ranks below another: a lower score, or the same score further down the list.
+ */
+static TUI_INLINE bool __tui_match_worse(const tui_match* a, const tui_match* b){
+	return a->score < b->score || (a->score == b->score && a->index > b->index);
+}
+
+/**
+ * Adds a match to a heap of the best k matches, if it is good enough.
+ *
+ * @return True if the heap changed.
+ */
+static bool __tui_top_push(tui_match* heap, size_t* len, size_t k, tui_match m){
+	size_t i;
+
+	if (*len < k){
+		// sift up from the new leaf
+		i = (*len)++;
+		while (i > 0 && __tui_match_worse(&m, &heap[(i - 1) / 2])){
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+		heap[i] = m;
+		return true;
+	}
+	if (!__tui_match_worse(&heap[0], &m)){
+		return false;
+	}
+
+	// replace the worst match and sift down
+	i = 0;
+	for (;;){
+		size_t c = 2 * i + 1;
+		if (c >= *len){
+			break;
+		}
+		if (c + 1 < *len && __tui_match_worse(&heap[c + 1], &heap[c])){
+			c++;
+		}
+		if (!__tui_match_worse(&heap[c], &m)){
+			break;
+		}
+		heap[i] = heap[c];
+		i = c;
+	}
+	heap[i] = m;
+	return true;
+}
+
+static int __tui_match_cmp(const void* a, const void* b){
+	const tui_match* m1 = a;
+	const tui_match* m2 = b;
+
+	return __tui_match_worse(m1, m2) ? 1 : __tui_match_worse(m2, m1) ? -1 : 0;
+}
+
+/**
+ * Tells the caller there are new results.
+ * Must be called with the lock held.
+ */
+static void __tui_filter_notify(struct tui_filter* f){
+	char c = 0;
+
+	if (!f->notified){
+		f->notified = true;
+		(void)!write(f->pipe[1], &c, 1);
+	}
+}
+
+/**
+ * Packs the matches of every chunk together and keeps them for narrowing the next search.
+ * Must be called with the lock held.
+ */
+static void __tui_filter_finish(struct tui_filter* f){
+	uint32_t* out = f->buf[f->out_buf];
+	size_t len = 0;
+
+	for (size_t c = 0; c < f->n_chunks; ++c){
+		memmove(out + len, out + c * TUI_FILTER_CHUNK, f->chunk_len[c] * sizeof(*out));
+		len += f->chunk_len[c];
+	}
+	f->base = f->out_buf;
+	f->base_len = len;
+	strcpy(f->base_query, f->query);
+	f->done = true;
+	__tui_filter_notify(f);
+}
+
+/**
+ * Scores one chunk of the search in progress.
+ *
+ * @return The number of matches, or -1 if the search was cancelled.
+ */
+static ptrdiff_t __tui_filter_chunk(struct tui_filter_worker* w, size_t chunk, unsigned gen){
+	struct tui_filter* f = w->f;
+	size_t start = chunk * TUI_FILTER_CHUNK;
+	size_t end = start + TUI_FILTER_CHUNK < f->n_cand ? start + TUI_FILTER_CHUNK : f->n_cand;
+	uint32_t* out = f->buf[f->out_buf] + start;
+	ptrdiff_t n = 0;
+
+	w->top_len = 0;
+	for (size_t i = start; i < end; ++i){
+		uint32_t index = f->cand ? f->cand[i] : (uint32_t)i;
+		tui_match m;
+
+		if (i % TUI_FILTER_CANCEL_CHECK == 0 && atomic_load_explicit(&f->gen, memory_order_relaxed) != gen){
+			return -1;
+		}
+		m.score = __tui_filter_score(f->choices[index], f->query);
+		if (m.score < 0){
+			continue;
+		}
+		m.index = index;
+		out[n++] = index;
+		__tui_top_push(w->top, &w->top_len, f->k, m);
+	}
+	return n;
+}
+
+static void* __tui_filter_worker(void* arg){
+	struct tui_filter_worker* w = arg;
+	struct tui_filter* f = w->f;
+
+	pthread_mutex_lock(&f->lock);
+	for (;;){
+		size_t chunk;
+		unsigned gen;
+		ptrdiff_t n;
+		bool changed = false;
+
+		while (!f->quit && f->next_chunk >= f->n_chunks){
+			pthread_cond_wait(&f->work, &f->lock);
+		}
+		if (f->quit){
+			break;
+		}
+		chunk = f->next_chunk++;
+		gen = atomic_load_explicit(&f->gen, memory_order_relaxed);
+		f->busy++;
+
+		pthread_mutex_unlock(&f->lock);
+		n = __tui_filter_chunk(w, chunk, gen);
+		pthread_mutex_lock(&f->lock);
+
+		f->busy--;
+		if (n >= 0 && gen == atomic_load_explicit(&f->gen, memory_order_relaxed)){
+			for (size_t i = 0; i < w->top_len; ++i){
+				changed |= __tui_top_push(f->top, &f->top_len, f->k, w->top[i]);
+			}
+			f->chunk_len[chunk] = (size_t)n;
+			f->matched += (size_t)n;
+			if (++f->chunks_done == f->n_chunks){
+				__tui_filter_finish(f);
+			}
+			else if (changed){
+				__tui_filter_notify(f);
+			}
+		}
+		if (f->busy == 0){
+			pthread_cond_broadcast(&f->idle);
+		}
+	}
+	pthread_mutex_unlock(&f->lock);
+	return NULL;
+}
+
+/**
+ * Makes sure a string buffer can hold len bytes, without touching the old buffer if it has to move.
+ *
+ * @return The buffer to use, which is the old one if it was big enough, or NULL if out of memory.
+ */
+static char* __tui_filter_strbuf(char* buf, size_t cap, size_t len){
+	return len <= cap ? buf : malloc(len);
+}
+
+int tui_filter_query(tui_filter* f, const char* query){
+	size_t len = strlen(query) + 1;
+	char* q;
+	char* bq;
+	bool narrow;
+
+	// allocate first, so running out of memory leaves the search in progress alone
+	q = __tui_filter_strbuf(f->query, f->query_cap, len);
+	bq = __tui_filter_strbuf(f->base_query, f->base_query_cap, len);
+	if (!q || !bq){
+		if (q != f->query){
+			free(q);
+		}
+		if (bq != f->base_query){
+			free(bq);
+		}
+		return TUI_ENOMEM;
+	}
+
+	pthread_mutex_lock(&f->lock);
+	atomic_fetch_add_explicit(&f->gen, 1, memory_order_relaxed);
+	f->next_chunk = f->n_chunks;
+	while (f->busy > 0){
+		pthread_cond_wait(&f->idle, &f->lock);
+	}
+
+	if (q != f->query){
+		free(f->query);
+		f->query = q;
+		f->query_cap = len;
+	}
+	if (bq != f->base_query){
+		// the old base query still decides whether this search can be narrowed
+		if (f->base_query){
+			strcpy(bq, f->base_query);
+		}
+		else{
+			bq[0] = '\0';
+		}
+		free(f->base_query);
+		f->base_query = bq;
+		f->base_query_cap = len;
+	}
+	for (size_t i = 0; i < len; ++i){
+		f->query[i] = (char)__tui_lower((unsigned char)query[i]);
+	}
+
+	narrow = f->base >= 0 && strncmp(f->base_query, f->query, strlen(f->base_query)) == 0;
+	f->cand = narrow ? f->buf[f->base] : NULL;
+	f->n_cand = narrow ? f->base_len : f->len;
+	f->out_buf = f->base == 0 ? 1 : 0;
+	f->n_chunks = (f->n_cand + TUI_FILTER_CHUNK - 1) / TUI_FILTER_CHUNK;
+	f->next_chunk = 0;
+	f->chunks_done = 0;
+	f->matched = 0;
+	f->top_len = 0;
+	f->done = false;
+
+	if (f->n_chunks == 0){
+		__tui_filter_finish(f);
+	}
+	else{
+		// the old results are gone, so the caller should stop showing them
+		__tui_filter_notify(f);
+		pthread_cond_broadcast(&f->work);
+	}
+	pthread_mutex_unlock(&f->lock);
+	return TUI_OK;
+}
+
+int tui_filter_fd(const tui_filter* f){
+	return f->pipe[0];
+}
+
+int tui_filter_results(tui_filter* f, size_t* out, size_t* n, size_t* matched){
+	char buf[64];
+	tui_match* sorted = f->top + f->k;
+	int done;
+
+	pthread_mutex_lock(&f->lock);
+	while (read(f->pipe[0], buf, sizeof(buf)) > 0);
+	f->notified = false;
+
+	memcpy(sorted, f->top, f->top_len * sizeof(*sorted));
+	qsort(sorted, f->top_len, sizeof(*sorted), __tui_match_cmp);
+	for (size_t i = 0; i < f->top_len; ++i){
+		out[i] = sorted[i].index;
+	}
+	*n = f->top_len;
+	if (matched){
+		*matched = f->matched;
+	}
+	done = f->done;
+	pthread_mutex_unlock(&f->lock);
+	return done;
+}
+
+/**
+ * Frees a filter whose workers are not running.
+ */
+static void __tui_filter_destroy(tui_filter* f){
+	if (f->pipe[0] >= 0){
+		close(f->pipe[0]);
+		close(f->pipe[1]);
+	}
+	free(f->workers);
+	free(f->top);
+	free(f->chunk_len);
+	free(f->buf[0]);
+	free(f->buf[1]);
+	free(f->query);
+	free(f->base_query);
+	free(f);
+}
+
+int tui_filter_make(const char* const* choices, size_t len, size_t k, int threads, tui_filter** out){
+	tui_filter* f;
+	size_t max_chunks = (len + TUI_FILTER_CHUNK - 1) / TUI_FILTER_CHUNK;
+
+	if (len >= UINT32_MAX || k == 0 || k > SIZE_MAX / sizeof(tui_match) / 2 - 1){
+		return TUI_EINVAL;
+	}
+	if (threads <= 0){
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = n > 0 ? (int)n : 1;
+	}
+
+	f = calloc(1, sizeof(*f));
+	if (!f){
+		return TUI_ENOMEM;
+	}
+	f->choices = choices;
+	f->len = len;
+	f->k = k;
+	f->base = -1;
+	f->pipe[0] = -1;
+	f->pipe[1] = -1;
+	atomic_init(&f->gen, 0);
+
+	// the heap of the search, then a buffer to sort it in, then one heap per worker
+	f->workers = calloc((size_t)threads, sizeof(*f->workers));
+	f->top = malloc((2 + (size_t)threads) * k * sizeof(*f->top));
+	f->chunk_len = malloc((max_chunks ? max_chunks : 1) * sizeof(*f->chunk_len));
+	f->buf[0] = malloc((len ? len : 1) * sizeof(*f->buf[0]));
+	f->buf[1] = malloc((len ? len : 1) * sizeof(*f->buf[1]));
+	if (!f->workers || !f->top || !f->chunk_len || !f->buf[0] || !f->buf[1] || pipe(f->pipe) != 0){
+		__tui_filter_destroy(f);
+		return TUI_ENOMEM;
+	}
+	for (int i = 0; i < 2; ++i){
+		fcntl(f->pipe[i], F_SETFL, fcntl(f->pipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(f->pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	pthread_mutex_init(&f->lock, NULL);
+	pthread_cond_init(&f->work, NULL);
+	pthread_cond_init(&f->idle, NULL);
+	for (int i = 0; i < threads; ++i){
+		struct tui_filter_worker* w = &f->workers[i];
+
+		w->f = f;
+		w->top = f->top + (2 + (size_t)i) * k;
+		if (pthread_create(&w->thread, NULL, __tui_filter_worker, w) != 0){
+			break;
+		}
+		f->n_workers++;
+	}
+	if (f->n_workers < threads || tui_filter_query(f, "") != TUI_OK){
+		tui_filter_free(f);
+		return TUI_ENOMEM;
+	}
+
+	*out = f;
+	return TUI_OK;
+}
+
+void tui_filter_free(tui_filter* f){
+	pthread_mutex_lock(&f->lock);
+	f->quit = true;
+	atomic_fetch_add_explicit(&f->gen, 1, memory_order_relaxed);
+	pthread_cond_broadcast(&f->work);
+	pthread_mutex_unlock(&f->lock);
+
+	for (int i = 0; i < f->n_workers; ++i){
+		pthread_join(f->workers[i].thread, NULL);
+	}
+	pthread_cond_destroy(&f->idle);
+	pthread_cond_destroy(&f->work);
+	pthread_mutex_destroy(&f->lock);
+	__tui_filter_destroy(f);
+}
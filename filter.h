@@ -0,0 +1,82 @@
+/** @file filter.h
+ * @brief Fuzzy filtering of a large list of choices on a pool of worker threads.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_FILTER_H
+#define __TUI_FILTER_H
+
+#include "attribute.h"
+#include <stddef.h>
+
+/**
+ * @brief Filters choices by a query while the caller keeps drawing.
+ * A query matches a choice if its characters appear in the choice in order, ignoring ASCII case.
+ * Matches are ranked by how many of those characters are consecutive or start a word, then by their position in the list.
+ * @see tui_filter_make()
+ */
+typedef struct tui_filter tui_filter;
+
+/**
+ * Makes a filter over a list of choices and starts its worker threads.
+ * The filter starts out with an empty query, which matches everything.
+ *
+ * @param choices The choices. The array is not copied, so it has to outlive the filter and stay unchanged.
+ * @param len The number of choices. At most 2^32 - 1.
+ * @param k How many of the best matches to keep. This is usually the number of rows the results are shown in.
+ * @param threads How many worker threads to start, or 0 for one per processor.
+ * @param out Set to the filter.
+ *
+ * @return TUI_OK on success, TUI_ENOMEM if out of memory or threads could not be started,
+ * or TUI_EINVAL if len or k is out of range.
+ */
+int tui_filter_make(const char* const* choices, size_t len, size_t k, int threads, tui_filter** out);
+
+/**
+ * Starts filtering by a new query, cancelling the search that is still running, if any.
+ * The search runs in the background, so this returns right away.<br>
+ * If the query extends the last query whose search finished, only the choices that matched that query are searched again.
+ * Typing one more character therefore only looks at what is still on the list.
+ *
+ * @param f The filter.
+ * @param query The query. It is copied.
+ *
+ * @return TUI_OK on success, or TUI_ENOMEM if out of memory. On failure the previous search keeps running.
+ */
+int tui_filter_query(tui_filter* f, const char* query);
+
+/**
+ * Gets a file descriptor that becomes readable when there are new results.
+ * Watch it with tui_add_fd() and call tui_filter_results() when it is ready.
+ * The first results are reported as soon as any worker finished part of the list,
+ * and again every time the best matches change, so they can be shown before the search is complete.
+ *
+ * @param f The filter.
+ *
+ * @return The file descriptor. It belongs to the filter and must not be closed.
+ */
+int tui_filter_fd(const tui_filter* f);
+
+/**
+ * Gets the best matches found so far for the current query, best first.
+ *
+ * @param f The filter.
+ * @param out Filled with the indices of up to k choices, where k was given to tui_filter_make().
+ * @param n Set to the number of indices written.
+ * @param matched Set to how many choices matched so far, including ones that didn't make the top k. This may be NULL.
+ *
+ * @return 1 if the search is complete, 0 if it is still running.
+ */
+int tui_filter_results(tui_filter* f, size_t* out, size_t* n, size_t* matched);
+
+/**
+ * Stops the worker threads and frees the filter.
+ *
+ * @param f The filter.
+ */
+void tui_filter_free(tui_filter* f);
+
+#endif
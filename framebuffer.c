@@ -0,0 +1,521 @@
+/** @file framebuffer.c
+ * @brief Double-buffered grid of character cells that windows are drawn into.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "framebuffer.h"
+
+#include "backend.h"
+#include "stats.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const tui_cell blank_cell = { { ' ', '\0', '\0', '\0' }, TUI_NORMAL };
+
+static size_t __tui_utf8_len(unsigned char lead){
+	if (lead < 0x80){
+		return 1;
+	}
+	if ((lead & 0xE0) == 0xC0){
+		return 2;
+	}
+	if ((lead & 0xF0) == 0xE0){
+		return 3;
+	}
+	if ((lead & 0xF8) == 0xF0){
+		return 4;
+	}
+	// stray continuation byte. treat it as its own character so we always make progress
+	return 1;
+}
+
+static size_t __tui_glyph_len(const tui_cell* cell){
+	size_t len = __tui_utf8_len((unsigned char)cell->glyph[0]);
+	for (size_t i = 1; i < len; ++i){
+		if (cell->glyph[i] == '\0'){
+			return i;
+		}
+	}
+	return len;
+}
+
+static TUI_INLINE bool __tui_cell_eq(const tui_cell* c1, const tui_cell* c2){
+	return memcmp(c1->glyph, c2->glyph, sizeof(c1->glyph)) == 0 && c1->attr == c2->attr;
+}
+
+static void __tui_fill_blank(tui_cell* cells, size_t n){
+	for (size_t i = 0; i < n; ++i){
+		cells[i] = blank_cell;
+	}
+}
+
+/**
+ * Gets the size of the hash table of rows, a power of 2 at least twice the number of rows.
+ */
+static size_t __tui_fb_table_size(int rows){
+	size_t size = 16;
+
+	while (size < (size_t)rows * 2){
+		size *= 2;
+	}
+	return size;
+}
+
+int tui_fb_resize(tui_framebuffer* fb, int rows, int cols){
+	tui_cell* back;
+	tui_cell* front;
+	uint64_t* row_hash;
+	int* row_scratch;
+	size_t n;
+
+	if (rows < 0 || cols < 0){
+		return -1;
+	}
+	if (rows == fb->rows && cols == fb->cols && fb->back){
+		tui_fb_clear(fb);
+		tui_fb_invalidate(fb);
+		return 0;
+	}
+
+	n = (size_t)rows * (size_t)cols;
+	back = malloc((n ? n : 1) * sizeof(*back));
+	front = malloc((n ? n : 1) * sizeof(*front));
+	row_hash = malloc(((size_t)rows * 2 + 1) * sizeof(*row_hash));
+	row_scratch = malloc((__tui_fb_table_size(rows) + (size_t)rows * 2 + 1) * sizeof(*row_scratch));
+	if (!back || !front || !row_hash || !row_scratch){
+		free(back);
+		free(front);
+		free(row_hash);
+		free(row_scratch);
+		return -1;
+	}
+
+	free(fb->back);
+	free(fb->front);
+	free(fb->row_hash);
+	free(fb->row_scratch);
+	fb->back = back;
+	fb->front = front;
+	fb->row_hash = row_hash;
+	fb->row_scratch = row_scratch;
+	fb->rows = rows;
+	fb->cols = cols;
+
+	tui_fb_clear(fb);
+	tui_fb_invalidate(fb);
+	return 0;
+}
+
+void tui_fb_clear(tui_framebuffer* fb){
+	__tui_fill_blank(fb->back, (size_t)fb->rows * (size_t)fb->cols);
+}
+
+void tui_fb_clearrect(tui_framebuffer* fb, int row1, int col1, int row2, int col2){
+	if (row1 < 0){
+		row1 = 0;
+	}
+	if (col1 < 0){
+		col1 = 0;
+	}
+	if (row2 >= fb->rows){
+		row2 = fb->rows - 1;
+	}
+	if (col2 >= fb->cols){
+		col2 = fb->cols - 1;
+	}
+	for (int row = row1; row <= row2 && col1 <= col2; ++row){
+		__tui_fill_blank(&fb->back[(size_t)row * fb->cols + col1], (size_t)(col2 - col1 + 1));
+	}
+}
+
+void tui_fb_putglyph(tui_framebuffer* fb, int row, int col, const char* glyph, tui_style attr){
+	tui_cell* cell;
+	size_t len;
+
+	if (row < 0 || row >= fb->rows || col < 0 || col >= fb->cols || glyph[0] == '\0'){
+		return;
+	}
+
+	cell = &fb->back[(size_t)row * fb->cols + col];
+	len = __tui_utf8_len((unsigned char)glyph[0]);
+	memset(cell->glyph, '\0', sizeof(cell->glyph));
+	for (size_t i = 0; i < len && glyph[i] != '\0'; ++i){
+		cell->glyph[i] = glyph[i];
+	}
+	cell->attr = attr;
+}
+
+void tui_fb_putrun(tui_framebuffer* fb, int row, int col, const tui_cell* run, int n){
+	if (row < 0 || row >= fb->rows){
+		return;
+	}
+	if (col < 0){
+		run -= col;
+		n += col;
+		col = 0;
+	}
+	if (n > fb->cols - col){
+		n = fb->cols - col;
+	}
+	if (n > 0){
+		memcpy(&fb->back[(size_t)row * fb->cols + col], run, (size_t)n * sizeof(*run));
+	}
+}
+
+int tui_fb_puts(tui_framebuffer* fb, int row, int col, const char* str, tui_style attr){
+	return tui_fb_putsn(fb, row, col, str, SIZE_MAX, INT_MAX, attr);
+}
+
+int tui_fb_putsn(tui_framebuffer* fb, int row, int col, const char* str, size_t len, int width, tui_style attr){
+	int col_end = width < fb->cols - col ? col + width : fb->cols;
+	int written = 0;
+
+	while (len > 0 && *str != '\0' && col < col_end){
+		size_t n = __tui_utf8_len((unsigned char)*str);
+		if (len < n){
+			break;
+		}
+		if (col >= 0){
+			tui_fb_putglyph(fb, row, col, str, attr);
+			written++;
+		}
+		for (size_t i = 0; i < n && *str != '\0'; ++i){
+			str++;
+			len--;
+		}
+		col++;
+	}
+	return written;
+}
+
+size_t tui_fb_width(const char* str, size_t len){
+	size_t width = 0;
+
+	for (size_t i = 0; i < len && str[i] != '\0'; ++i){
+		// every byte but a continuation byte starts a character
+		width += ((unsigned char)str[i] & 0xC0) != 0x80;
+	}
+	return width;
+}
+
+void tui_fb_invalidate(tui_framebuffer* fb){
+	fb->front_valid = false;
+}
+
+/* scrolling has to save redrawing at least this many rows to be worth the escape sequences */
+#define TUI_SCROLL_MIN_GAIN (2)
+
+#define TUI_FNV_BASIS (14695981039346656037u)
+#define TUI_FNV_PRIME (1099511628211u)
+
+static TUI_INLINE uint64_t __tui_cell_hash(uint64_t h, const tui_cell* cell){
+	uint32_t glyph;
+
+	memcpy(&glyph, cell->glyph, sizeof(glyph));
+	h = (h ^ glyph) * TUI_FNV_PRIME;
+	return (h ^ cell->attr) * TUI_FNV_PRIME;
+}
+
+/**
+ * Hashes a row of cells.
+ * If row is NULL, hashes a blank row instead.
+ */
+static uint64_t __tui_row_hash(const tui_cell* row, int cols){
+	uint64_t h = TUI_FNV_BASIS;
+
+	for (int col = 0; col < cols; ++col){
+		h = __tui_cell_hash(h, row ? &row[col] : &blank_cell);
+	}
+	return h;
+}
+
+static bool __tui_row_eq(const tui_cell* r1, const tui_cell* r2, int cols){
+	for (int col = 0; col < cols; ++col){
+		if (!__tui_cell_eq(&r1[col], &r2[col])){
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Finds how far most of the changed rows moved since the last flush.
+ * Every changed row of the back buffer that appears exactly once in the front buffer votes for the distance between the two.
+ * Blank rows and rows that appear more than once don't say where anything went, so they don't vote.
+ *
+ * @return The distance in rows, positive if the rows moved up, or 0 if nothing moved far enough to be worth scrolling.
+ */
+static int __tui_fb_scroll_offset(tui_framebuffer* fb, uint64_t blank){
+	int rows = fb->rows;
+	const uint64_t* hb = fb->row_hash;
+	const uint64_t* hf = fb->row_hash + rows;
+	size_t mask = __tui_fb_table_size(rows) - 1;
+	// each slot is -1 if empty, the front row with that hash, or -2 - the first such row if there is more than one
+	int* table = fb->row_scratch;
+	int* votes = fb->row_scratch + mask + 1 + rows;
+	int best = 0;
+
+	for (size_t i = 0; i <= mask; ++i){
+		table[i] = -1;
+	}
+	for (int k = -rows; k <= rows; ++k){
+		votes[k] = 0;
+	}
+
+	for (int row = 0; row < rows; ++row){
+		size_t i = (size_t)hf[row] & mask;
+
+		if (hf[row] == blank){
+			continue;
+		}
+		while (table[i] != -1){
+			int f = table[i] >= 0 ? table[i] : -2 - table[i];
+			if (hf[f] == hf[row]){
+				break;
+			}
+			i = (i + 1) & mask;
+		}
+		if (table[i] == -1){
+			table[i] = row;
+		}
+		else if (table[i] >= 0){
+			table[i] = -2 - table[i];
+		}
+	}
+
+	for (int row = 0; row < rows; ++row){
+		size_t i = (size_t)hb[row] & mask;
+
+		if (hb[row] == hf[row] || hb[row] == blank){
+			continue;
+		}
+		while (table[i] != -1){
+			int f = table[i] >= 0 ? table[i] : -2 - table[i];
+			if (hf[f] == hb[row]){
+				if (table[i] >= 0){
+					votes[f - row]++;
+				}
+				break;
+			}
+			i = (i + 1) & mask;
+		}
+	}
+
+	for (int k = 1 - rows; k < rows; ++k){
+		if (votes[k] > votes[best]){
+			best = k;
+		}
+	}
+	return votes[best] >= TUI_SCROLL_MIN_GAIN ? best : 0;
+}
+
+/**
+ * Starts a synchronized frame before the first thing is sent, so frames where nothing changed send nothing at all.
+ */
+static TUI_INLINE void __tui_fb_sync(bool* synced){
+	if (!*synced){
+		tui_sync(1);
+		*synced = true;
+	}
+}
+
+/**
+ * Scrolls the terminal if a band of full rows moved up or down, and updates the front buffer to match.
+ * Scrolling regions always span the full width of the terminal, so rows that only partly moved are redrawn as usual.
+ *
+ * @return True if the terminal scrolled, which leaves its cursor position unknown and its style reset.
+ */
+static bool __tui_fb_scroll(tui_framebuffer* fb, bool* synced){
+	int rows = fb->rows;
+	int cols = fb->cols;
+	uint64_t* hb = fb->row_hash;
+	uint64_t* hf = fb->row_hash + rows;
+	uint64_t blank;
+	int changed = 0;
+	int k;
+	int best_top = 0;
+	int best_bot = -1;
+	int best_gain = TUI_SCROLL_MIN_GAIN - 1;
+
+	for (int row = 0; row < rows; ++row){
+		hb[row] = __tui_row_hash(&fb->back[(size_t)row * cols], cols);
+		hf[row] = __tui_row_hash(&fb->front[(size_t)row * cols], cols);
+		changed += hb[row] != hf[row];
+	}
+	if (changed < TUI_SCROLL_MIN_GAIN){
+		return false;
+	}
+
+	blank = __tui_row_hash(NULL, cols);
+	k = __tui_fb_scroll_offset(fb, blank);
+	if (k == 0){
+		return false;
+	}
+
+	// find the band of rows that moved by k that saves the most
+	for (int row = k > 0 ? 0 : -k; row < (k > 0 ? rows - k : rows); ){
+		int top = row;
+		int gain = 0;
+
+		while (row < (k > 0 ? rows - k : rows) && hb[row] == hf[row + k] &&
+				__tui_row_eq(&fb->back[(size_t)row * cols], &fb->front[(size_t)(row + k) * cols], cols)){
+			gain += hb[row] != hf[row];
+			row++;
+		}
+		if (row == top){
+			row++;
+			continue;
+		}
+
+		// rows that scroll into view come in blank, so any that were already right have to be redrawn
+		for (int i = k > 0 ? row : top + k; i < (k > 0 ? row + k : top); ++i){
+			gain -= hb[i] == hf[i] && hf[i] != blank;
+		}
+		if (gain > best_gain){
+			best_gain = gain;
+			best_top = top;
+			best_bot = row - 1;
+		}
+	}
+	if (best_bot < 0){
+		return false;
+	}
+
+	__tui_fb_sync(synced);
+	tui_attrclear();
+	if (k > 0){
+		if (tui_scroll(best_top, best_bot + k, k) < 0){
+			return false;
+		}
+		memmove(&fb->front[(size_t)best_top * cols], &fb->front[(size_t)(best_top + k) * cols],
+			(size_t)(best_bot - best_top + 1) * cols * sizeof(*fb->front));
+		__tui_fill_blank(&fb->front[(size_t)(best_bot + 1) * cols], (size_t)k * cols);
+	}
+	else{
+		if (tui_scroll(best_top + k, best_bot, k) < 0){
+			return false;
+		}
+		memmove(&fb->front[(size_t)best_top * cols], &fb->front[(size_t)(best_top + k) * cols],
+			(size_t)(best_bot - best_top + 1) * cols * sizeof(*fb->front));
+		__tui_fill_blank(&fb->front[(size_t)(best_top + k) * cols], (size_t)-k * cols);
+	}
+	return true;
+}
+
+/**
+ * Moves the cursor forward within a row by writing the cells it passes over again, if that is shorter than moving it.
+ * The cells in between are unchanged, so this only works if they all have the style the terminal is set to.
+ *
+ * @return True if the cells were written, false if the cursor still has to be moved.
+ */
+static bool __tui_fb_rewrite(tui_framebuffer* fb, int row, int from, int to, tui_style attr){
+	const tui_cell* cells = &fb->back[(size_t)row * fb->cols];
+	int cost = tui_movecost(row, from, row, to);
+	int len = 0;
+
+	for (int col = from; col < to; ++col){
+		len += (int)__tui_glyph_len(&cells[col]);
+		if (len >= cost || cells[col].attr != attr){
+			return false;
+		}
+	}
+	for (int col = from; col < to; ++col){
+		tui_write(cells[col].glyph, __tui_glyph_len(&cells[col]));
+	}
+	return true;
+}
+
+int tui_fb_flush(tui_framebuffer* fb){
+	// where the terminal's cursor is, or -1 if we don't know
+	int cur_row = -1;
+	int cur_col = -1;
+	tui_style cur_attr = TUI_NORMAL;
+	bool attr_known = false;
+	bool synced = false;
+	size_t emitted = 0;
+
+	if (!fb->front_valid){
+		// start from a blank screen so only the non-blank cells need to be sent
+		__tui_fb_sync(&synced);
+		tui_attrclear();
+		attr_known = true;
+		tui_clear();
+		cur_row = 0;
+		cur_col = 0;
+		__tui_fill_blank(fb->front, (size_t)fb->rows * (size_t)fb->cols);
+		fb->front_valid = true;
+	}
+	else if (fb->rows >= 4 && __tui_fb_scroll(fb, &synced)){
+		attr_known = true;
+	}
+
+	for (int row = 0; row < fb->rows; ++row){
+		for (int col = 0; col < fb->cols; ++col){
+			size_t i = (size_t)row * fb->cols + col;
+			tui_cell* back = &fb->back[i];
+
+			if (__tui_cell_eq(back, &fb->front[i])){
+				continue;
+			}
+			__tui_fb_sync(&synced);
+
+			if (row != cur_row || col != cur_col){
+				bool rewritten = attr_known && row == cur_row && col > cur_col &&
+					__tui_fb_rewrite(fb, row, cur_col, col, cur_attr);
+				if (!rewritten){
+					tui_movecursor(cur_row, cur_col, row, col);
+				}
+			}
+			if (!attr_known || back->attr != cur_attr){
+				tui_attrset(back->attr);
+				cur_attr = back->attr;
+				attr_known = true;
+			}
+			tui_write(back->glyph, __tui_glyph_len(back));
+			fb->front[i] = *back;
+			emitted++;
+
+			cur_row = row;
+			cur_col = col + 1;
+			// the cursor is in a pending-wrap state after the last column, so its position is not reliable
+			if (cur_col >= fb->cols){
+				cur_row = -1;
+			}
+		}
+	}
+
+	if (attr_known && cur_attr != TUI_NORMAL){
+		tui_attrclear();
+	}
+	if (synced){
+		tui_sync(0);
+	}
+	TUI_STAT_ADD(cells_compared, (size_t)fb->rows * (size_t)fb->cols);
+	TUI_STAT_ADD(cells_emitted, emitted);
+
+	// the front buffer already holds this frame, so if it never reached the terminal, the next one has to repaint everything
+	if (tui_flush() != 0){
+		tui_fb_invalidate(fb);
+		return -1;
+	}
+	return 0;
+}
+
+void tui_fb_free(tui_framebuffer* fb){
+	free(fb->back);
+	free(fb->front);
+	free(fb->row_hash);
+	free(fb->row_scratch);
+	fb->back = NULL;
+	fb->front = NULL;
+	fb->row_hash = NULL;
+	fb->row_scratch = NULL;
+	fb->rows = 0;
+	fb->cols = 0;
+	fb->front_valid = false;
+}
@@ -0,0 +1,198 @@
+/** @file framebuffer.h
+ * @brief Double-buffered grid of character cells that windows are drawn into.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_FRAMEBUFFER_H
+#define __TUI_FRAMEBUFFER_H
+
+#include "attribute.h"
+#include "backend.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A single character cell of the screen.
+ * A cell is 16 bytes, so four of them fill a cache line and none straddles two.
+ */
+typedef struct tui_cell{
+	/**
+	 * @brief The UTF-8 encoding of the glyph in this cell.
+	 * Encodings shorter than 4 bytes are padded with '\0'.
+	 */
+	char glyph[4];
+
+	/**
+	 * @brief The style the glyph is drawn with.
+	 * @see tui_style
+	 */
+	tui_style attr;
+}tui_cell;
+
+/**
+ * @brief A back buffer that is drawn into and a front buffer holding what the terminal currently shows.
+ * Flushing the framebuffer only sends the cells that differ between the two to the terminal.
+ */
+typedef struct tui_framebuffer{
+	int rows;
+	int cols;
+
+	/**
+	 * @brief The next frame. Drawing functions write here.
+	 */
+	tui_cell* back;
+
+	/**
+	 * @brief The last frame that was sent to the terminal.
+	 */
+	tui_cell* front;
+
+	/**
+	 * @brief False if the terminal's contents are unknown, which forces the next flush to repaint everything.
+	 */
+	bool front_valid;
+
+	/**
+	 * @brief Scratch space for finding rows that moved: a hash of every row of both buffers,
+	 * a hash table of the front buffer's rows, and a vote for every possible offset.
+	 */
+	uint64_t* row_hash;
+	int* row_scratch;
+}tui_framebuffer;
+
+/**
+ * Resizes a framebuffer, allocating it if it is empty.
+ * A zero-initialized tui_framebuffer is empty.<br>
+ * Both buffers are blanked and the next flush repaints the whole screen.
+ *
+ * @param fb The framebuffer.
+ * @param rows The new height in rows.
+ * @param cols The new width in columns.
+ *
+ * @return 0 on success, negative on failure.<br>
+ * On failure the framebuffer is left unchanged.
+ */
+int tui_fb_resize(tui_framebuffer* fb, int rows, int cols);
+
+/**
+ * Blanks the back buffer.
+ *
+ * @param fb The framebuffer.
+ */
+void tui_fb_clear(tui_framebuffer* fb);
+
+/**
+ * Blanks a rectangle of the back buffer.
+ * The parts of the rectangle outside of the framebuffer are ignored.
+ *
+ * @param fb The framebuffer.
+ * @param row1 The top row of the rectangle.
+ * @param col1 The left column of the rectangle.
+ * @param row2 The bottom row of the rectangle, inclusive.
+ * @param col2 The right column of the rectangle, inclusive.
+ */
+void tui_fb_clearrect(tui_framebuffer* fb, int row1, int col1, int row2, int col2);
+
+/**
+ * Writes a single glyph into the back buffer.
+ * Positions outside of the framebuffer are ignored.
+ *
+ * @param fb The framebuffer.
+ * @param row The row to write to.
+ * @param col The column to write to.
+ * @param glyph A UTF-8 string. Only its first character is used.
+ * @param attr The attributes to draw the glyph with.
+ */
+void tui_fb_putglyph(tui_framebuffer* fb, int row, int col, const char* glyph, tui_style attr);
+
+/**
+ * Copies a run of already encoded cells into one row of the back buffer.
+ * The run is clipped at the edges of the framebuffer.<br>
+ * This is a single memcpy, so it is the fastest way to draw repeated glyphs such as borders.
+ *
+ * @param fb The framebuffer.
+ * @param row The row to write to.
+ * @param col The column of the first cell.
+ * @param run The cells to copy.
+ * @param n The number of cells.
+ */
+void tui_fb_putrun(tui_framebuffer* fb, int row, int col, const tui_cell* run, int n);
+
+/**
+ * Writes a UTF-8 string into the back buffer, one character per cell.
+ * The string is clipped at the right edge of the framebuffer.
+ *
+ * @param fb The framebuffer.
+ * @param row The row to write to.
+ * @param col The column of the first character.
+ * @param str The string to write.
+ * @param attr The attributes to draw the string with.
+ *
+ * @return The number of cells written.
+ */
+int tui_fb_puts(tui_framebuffer* fb, int row, int col, const char* str, tui_style attr);
+
+/**
+ * Writes part of a UTF-8 string into the back buffer, one character per cell.
+ * Unlike tui_fb_puts(), the string doesn't need to be null-terminated,
+ * so a slice of a larger buffer can be drawn without copying it.<br>
+ * A character cut off by the end of the slice is not written.
+ *
+ * @param fb The framebuffer.
+ * @param row The row to write to.
+ * @param col The column of the first character.
+ * @param str The string to write.
+ * @param len The maximum number of bytes to read. The string also ends at a null byte.
+ * @param width The maximum number of cells to use, starting at col.
+ * @param attr The attributes to draw the string with.
+ *
+ * @return The number of cells written.
+ */
+int tui_fb_putsn(tui_framebuffer* fb, int row, int col, const char* str, size_t len, int width, tui_style attr);
+
+/**
+ * Gets how many cells a UTF-8 string takes up, which is one per character.
+ *
+ * @param str The string.
+ * @param len The maximum number of bytes to read. The string also ends at a null byte.
+ *
+ * @return The number of cells.
+ */
+size_t tui_fb_width(const char* str, size_t len);
+
+/**
+ * Marks the terminal's contents as unknown.
+ * The next flush clears the screen and repaints every non-blank cell.<br>
+ * Call this if something other than the framebuffer wrote to the terminal.
+ *
+ * @param fb The framebuffer.
+ */
+void tui_fb_invalidate(tui_framebuffer* fb);
+
+/**
+ * Sends the cells of the back buffer that differ from the front buffer to the terminal.
+ * Afterwards the front buffer matches the back buffer.<br>
+ * If a band of rows moved up or down, the terminal is told to scroll it with tui_scroll(),
+ * and only the rows that came into view are sent.<br>
+ * If anything is sent, it is bracketed with tui_sync() so the terminal shows the frame all at once.<br>
+ * The whole frame is sent with a single tui_flush().
+ *
+ * @param fb The framebuffer.
+ *
+ * @return 0 on success, negative on failure.
+ */
+int tui_fb_flush(tui_framebuffer* fb);
+
+/**
+ * Frees the buffers of a framebuffer.
+ * The framebuffer is empty afterwards.
+ *
+ * @param fb The framebuffer.
+ */
+void tui_fb_free(tui_framebuffer* fb);
+
+#endif
@@ -0,0 +1,92 @@
+/** @file headless.h
+ * @brief A backend that renders into memory instead of a terminal.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_HEADLESS_H
+#define __TUI_HEADLESS_H
+
+#include "attribute.h"
+#include "backend.h"
+#include "framebuffer.h"
+#include <stddef.h>
+
+/**
+ * Gets the headless backend.
+ * Output is encoded as the same escape sequences a terminal would receive,
+ * and every flush runs them through a VT100-style interpreter that updates a virtual screen.<br>
+ * That makes it possible to test and benchmark rendering without a terminal:
+ * ```C
+ * tui_set_backend(tui_headless_backend());
+ * tui_show(stdwin);
+ * const tui_cell* c = tui_headless_cell(0, 0);
+ * ```
+ * The screen starts out 24x80 and blank.
+ * Input comes only from tui_headless_input(), so tui_getch() returns EOF instead of waiting once it runs out.
+ *
+ * @return The headless backend.
+ */
+const tui_backend* TUI_API tui_headless_backend(void);
+
+/**
+ * Resizes the virtual screen, as if the user resized a terminal.
+ * The overlapping part of the screen is kept and the next tui_resized() returns 1.
+ *
+ * @param rows The new height in rows.
+ * @param cols The new width in columns.
+ *
+ * @return 0 on success, negative if the size is not positive or out of memory.
+ */
+int TUI_API tui_headless_resize(int rows, int cols);
+
+/**
+ * Queues bytes as if the user typed them.
+ * They are decoded into keys the same way terminal input is.<br>
+ * A partial escape sequence at the end of the bytes times out as soon as the keys are read,
+ * since no more input can arrive in the middle of a read.
+ *
+ * @param buf The bytes.
+ * @param len The number of bytes.
+ *
+ * @return 0 on success, negative if out of memory.
+ */
+int TUI_API tui_headless_input(const char* buf, size_t len);
+
+/**
+ * Gets a cell of the virtual screen.
+ * Its style is decoded from the escape sequences that were sent, so it equals the style that was drawn.
+ *
+ * @param row The row.
+ * @param col The column.
+ *
+ * @return The cell, or NULL if the position is off the screen.<br>
+ * The pointer is valid until the next flush or resize.
+ */
+const tui_cell* TUI_API tui_headless_cell(int row, int col);
+
+/**
+ * Copies the glyphs of one row of the virtual screen into a string.
+ *
+ * @param row The row.
+ * @param buf The buffer to write to. It is always null-terminated if size is not 0.
+ * @param size The size of the buffer. 4 * cols + 1 bytes always suffice.
+ *
+ * @return The length of the whole row in bytes, which may be larger than what fit in the buffer.
+ * Negative if the row is off the screen.
+ */
+int TUI_API tui_headless_line(int row, char* buf, size_t size);
+
+/**
+ * Gets where the virtual cursor is and whether it is visible.
+ * Any of the pointers may be NULL.
+ *
+ * @param row Set to the cursor's row.
+ * @param col Set to the cursor's column.
+ * @param visible Set to 1 if the cursor is shown, 0 if it is hidden.
+ */
+void TUI_API tui_headless_cursor(int* row, int* col, int* visible);
+
+#endif
@@ -0,0 +1,293 @@
+/** @file input.c
+ * @brief Decodes the bytes a terminal sends into keys.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "input.h"
+
+#include "backend.h"
+
+#define TUI_KD_GROUND (0) /**< Not in an escape sequence */
+#define TUI_KD_ESC    (1) /**< Read ESC */
+#define TUI_KD_CSI    (2) /**< Read ESC [ */
+#define TUI_KD_SS3    (3) /**< Read ESC O */
+#define TUI_KD_MOUSE  (4) /**< Read ESC [ M. The next three bytes are the mouse report */
+#define TUI_KD_UTF8   (5) /**< Read ESC and the first byte of a UTF-8 character */
+
+/* parameters larger than this are not keys, so there's no point in reading them precisely */
+#define TUI_KD_PARAM_MAX (9999)
+
+/**
+ * @brief Keys selected by the final byte of "ESC [ ... X".
+ */
+static const int csi_keys[128] = {
+	['A'] = KEY_UP,
+	['B'] = KEY_DOWN,
+	['C'] = KEY_RIGHT,
+	['D'] = KEY_LEFT,
+	['F'] = KEY_END,
+	['H'] = KEY_HOME,
+	['P'] = KEY_F(1),
+	['Q'] = KEY_F(2),
+	['R'] = KEY_F(3),
+	['S'] = KEY_F(4),
+	['Z'] = '\t' | KEY_MOD_SHIFT
+};
+
+/**
+ * @brief Keys selected by the final byte of "ESC O X".
+ */
+static const int ss3_keys[128] = {
+	['A'] = KEY_UP,
+	['B'] = KEY_DOWN,
+	['C'] = KEY_RIGHT,
+	['D'] = KEY_LEFT,
+	['F'] = KEY_END,
+	['H'] = KEY_HOME,
+	['M'] = KEY_ENTER,
+	['P'] = KEY_F(1),
+	['Q'] = KEY_F(2),
+	['R'] = KEY_F(3),
+	['S'] = KEY_F(4)
+};
+
+/**
+ * @brief Keys selected by the first parameter of "ESC [ n ~".
+ */
+static const int tilde_keys[35] = {
+	[1]  = KEY_HOME,
+	[2]  = KEY_INSERT,
+	[3]  = KEY_DELETE,
+	[4]  = KEY_END,
+	[5]  = KEY_PGUP,
+	[6]  = KEY_PGDOWN,
+	[7]  = KEY_HOME,
+	[8]  = KEY_END,
+	[11] = KEY_F(1),
+	[12] = KEY_F(2),
+	[13] = KEY_F(3),
+	[14] = KEY_F(4),
+	[15] = KEY_F(5),
+	[17] = KEY_F(6),
+	[18] = KEY_F(7),
+	[19] = KEY_F(8),
+	[20] = KEY_F(9),
+	[21] = KEY_F(10),
+	[23] = KEY_F(11),
+	[24] = KEY_F(12),
+	[25] = KEY_F(13),
+	[26] = KEY_F(14),
+	[28] = KEY_F(15),
+	[29] = KEY_F(16),
+	[31] = KEY_F(17),
+	[32] = KEY_F(18),
+	[33] = KEY_F(19),
+	[34] = KEY_F(20)
+};
+
+/**
+ * Converts an xterm modifier parameter ("ESC [ 1 ; m A") to KEY_MOD_* flags.
+ * The parameter is 1 + a bitmask of shift (1), alt (2), ctrl (4) and meta (8).
+ */
+static int __tui_kd_mods(int param){
+	int mask = param - 1;
+	int mods = 0;
+
+	if (mask <= 0){
+		return 0;
+	}
+	if (mask & 1){
+		mods |= KEY_MOD_SHIFT;
+	}
+	if (mask & (2 | 8)){
+		mods |= KEY_MOD_ALT;
+	}
+	if (mask & 4){
+		mods |= KEY_MOD_CTRL;
+	}
+	return mods;
+}
+
+void tui_kd_init(tui_keydecoder* kd){
+	kd->state = TUI_KD_GROUND;
+	kd->params[0] = 0;
+	kd->params[1] = 0;
+	kd->n_params = 0;
+	kd->ignore = false;
+	kd->remaining = 0;
+	kd->marker = 0;
+	kd->intermediate = 0;
+}
+
+static bool __tui_kd_csi_final(tui_keydecoder* kd, unsigned char c, int* key){
+	int k = 0;
+
+	if (kd->ignore){
+		if (c == 'y' && kd->marker == '?' && kd->intermediate == '$' && kd->on_mode){
+			kd->on_mode(kd->params[0], kd->params[1]);
+		}
+		return false;
+	}
+	if (c == '~'){
+		if (kd->params[0] < (int)(sizeof(tilde_keys) / sizeof(*tilde_keys))){
+			k = tilde_keys[kd->params[0]];
+		}
+	}
+	else{
+		k = csi_keys[c];
+	}
+
+	if (k == 0){
+		return false;
+	}
+	*key = k | __tui_kd_mods(kd->params[1]);
+	return true;
+}
+
+bool tui_kd_push(tui_keydecoder* kd, unsigned char c, int* key){
+	switch (kd->state){
+	case TUI_KD_GROUND:
+		if (c == '\033'){
+			kd->state = TUI_KD_ESC;
+			return false;
+		}
+		*key = c;
+		return true;
+
+	case TUI_KD_ESC:
+		if (c == '['){
+			tui_kd_init(kd);
+			kd->state = TUI_KD_CSI;
+			return false;
+		}
+		if (c == 'O'){
+			kd->state = TUI_KD_SS3;
+			return false;
+		}
+		// ESC ESC is an escape keypress followed by the start of another sequence
+		if (c == '\033'){
+			*key = KEY_ESCAPE;
+			return true;
+		}
+		kd->state = TUI_KD_GROUND;
+		// the rest of a multibyte character typed with alt gets alt as well, instead of coming out as stray bytes
+		if (c >= 0xC0 && c <= 0xF7){
+			kd->remaining = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+			kd->state = TUI_KD_UTF8;
+		}
+		*key = c | KEY_MOD_ALT;
+		return true;
+
+	case TUI_KD_UTF8:
+		if ((c & 0xC0) != 0x80){
+			// cut short. the byte starts something else
+			kd->state = TUI_KD_GROUND;
+			return tui_kd_push(kd, c, key);
+		}
+		if (--kd->remaining == 0){
+			kd->state = TUI_KD_GROUND;
+		}
+		*key = c | KEY_MOD_ALT;
+		return true;
+
+	case TUI_KD_MOUSE:
+		// the button and coordinates are raw bytes that can look like anything, including ESC
+		if (--kd->remaining == 0){
+			kd->state = TUI_KD_GROUND;
+		}
+		return false;
+
+	case TUI_KD_SS3:
+		kd->state = TUI_KD_GROUND;
+		if (c < 128 && ss3_keys[c] != 0){
+			*key = ss3_keys[c];
+			return true;
+		}
+		return false;
+
+	case TUI_KD_CSI:
+		if (c >= '0' && c <= '9'){
+			int* p = &kd->params[kd->n_params < 2 ? kd->n_params : 1];
+			if (*p <= TUI_KD_PARAM_MAX){
+				*p = *p * 10 + (c - '0');
+			}
+			return false;
+		}
+		if (c == ';'){
+			kd->n_params++;
+			return false;
+		}
+		// private markers ('<', '=', '>', '?') and intermediates mean this is not a key
+		if ((c >= 0x3A && c <= 0x3F) || (c >= 0x20 && c <= 0x2F)){
+			if (c >= 0x3C && c <= 0x3F){
+				kd->marker = c;
+			}
+			else if (c <= 0x2F){
+				kd->intermediate = c;
+			}
+			kd->ignore = true;
+			return false;
+		}
+		kd->state = TUI_KD_GROUND;
+		if (c == 'M' && !kd->ignore && kd->n_params == 0 && kd->params[0] == 0){
+			kd->state = TUI_KD_MOUSE;
+			kd->remaining = 3;
+			return false;
+		}
+		if (c >= 0x40 && c <= 0x7E){
+			return __tui_kd_csi_final(kd, c, key);
+		}
+		// malformed. a new sequence may be starting
+		if (c == '\033'){
+			kd->state = TUI_KD_ESC;
+		}
+		return false;
+	}
+
+	kd->state = TUI_KD_GROUND;
+	return false;
+}
+
+size_t tui_kd_feed(tui_keydecoder* kd, const unsigned char* buf, size_t len, int* keys, size_t n, size_t* n_keys){
+	size_t i = 0;
+	size_t k = 0;
+
+	while (i < len && k < n){
+		if (tui_kd_push(kd, buf[i], &keys[k])){
+			k++;
+		}
+		i++;
+	}
+	*n_keys = k;
+	return i;
+}
+
+bool tui_kd_pending(const tui_keydecoder* kd){
+	return kd->state != TUI_KD_GROUND;
+}
+
+bool tui_kd_timeout(tui_keydecoder* kd, int* key){
+	int state = kd->state;
+	bool params_read = kd->n_params > 0 || kd->params[0] > 0 || kd->ignore;
+
+	tui_kd_init(kd);
+	switch (state){
+	case TUI_KD_ESC:
+		*key = KEY_ESCAPE;
+		return true;
+	case TUI_KD_SS3:
+		*key = 'O' | KEY_MOD_ALT;
+		return true;
+	case TUI_KD_CSI:
+		if (params_read){
+			return false;
+		}
+		*key = '[' | KEY_MOD_ALT;
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,121 @@
+/** @file input.h
+ * @brief Decodes the bytes a terminal sends into keys.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_INPUT_H
+#define __TUI_INPUT_H
+
+#include "attribute.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Incremental decoder for terminal input.
+ * Bytes can be fed in chunks of any size, including sequences split across chunks.<br>
+ * Each byte takes constant time regardless of the sequence it is part of.
+ * A zero-initialized tui_keydecoder is ready to use.
+ */
+typedef struct tui_keydecoder{
+	/**
+	 * @brief Where in an escape sequence the decoder is.
+	 */
+	int state;
+
+	/**
+	 * @brief The numeric parameters of the current control sequence.
+	 */
+	int params[2];
+
+	/**
+	 * @brief The index of the parameter currently being read.
+	 */
+	int n_params;
+
+	/**
+	 * @brief True if the current control sequence is not a key (mouse reports, terminal replies, ...).
+	 * Such sequences are consumed and dropped.
+	 */
+	bool ignore;
+
+	/**
+	 * @brief The raw bytes left in a legacy mouse report ("ESC [ M" and three bytes),
+	 * or the continuation bytes left in a UTF-8 character typed with alt.
+	 */
+	int remaining;
+
+	/**
+	 * @brief The private marker ('?', '>', ...) and intermediate byte ('$', ' ', ...) of the current control sequence, or 0.
+	 */
+	unsigned char marker;
+	unsigned char intermediate;
+
+	/**
+	 * @brief Called with the mode and its state when the terminal answers a DECRQM query ("ESC [ ? mode ; state $ y").
+	 * The state is 0 if the mode is not recognized, 1 if set, 2 if reset, 3 if permanently set, and 4 if permanently reset.<br>
+	 * May be NULL, in which case the answers are dropped like any other reply. tui_kd_init() leaves it alone.
+	 */
+	void (*on_mode)(int mode, int state);
+}tui_keydecoder;
+
+/**
+ * Resets a decoder, discarding any partial escape sequence.
+ *
+ * @param kd The decoder.
+ */
+void tui_kd_init(tui_keydecoder* kd);
+
+/**
+ * Feeds a single byte to the decoder.
+ *
+ * @param kd The decoder.
+ * @param c The byte.
+ * @param key Set to the decoded key if one is complete.
+ * @see tui_getch() for the possible keys.
+ *
+ * @return True if a key was decoded, false if more bytes are needed or the byte was dropped.
+ */
+bool tui_kd_push(tui_keydecoder* kd, unsigned char c, int* key);
+
+/**
+ * Feeds a chunk of bytes to the decoder.
+ * Decoding stops early if the keys buffer fills up.
+ *
+ * @param kd The decoder.
+ * @param buf The bytes.
+ * @param len The number of bytes.
+ * @param keys The buffer to store decoded keys in.
+ * @param n The maximum number of keys to store.
+ * @param n_keys Set to the number of keys stored.
+ *
+ * @return The number of bytes consumed.
+ */
+size_t tui_kd_feed(tui_keydecoder* kd, const unsigned char* buf, size_t len, int* keys, size_t n, size_t* n_keys);
+
+/**
+ * Checks if the decoder is partway through an escape sequence.
+ * If no more bytes arrive within the escape timeout, tui_kd_timeout() should be called.
+ *
+ * @param kd The decoder.
+ *
+ * @return True if a sequence is incomplete.
+ */
+bool tui_kd_pending(const tui_keydecoder* kd);
+
+/**
+ * Tells the decoder that the rest of an incomplete escape sequence is not coming.
+ * A lone ESC becomes KEY_ESCAPE, and ESC followed by one character becomes that character with KEY_MOD_ALT.
+ * A character of several bytes typed with alt comes out as one key per byte, each with KEY_MOD_ALT.<br>
+ * Longer incomplete sequences are dropped.
+ *
+ * @param kd The decoder.
+ * @param key Set to the decoded key if there is one.
+ *
+ * @return True if a key was decoded.
+ */
+bool tui_kd_timeout(tui_keydecoder* kd, int* key);
+
+#endif
@@ -1,18 +1,30 @@
 #include "window.h"
+#include "event.h"
+#include <stdio.h>
 #include <stdlib.h>
 
+static void on_key(int key, void* data){
+	(void)data;
+	if (key == 'q' || key == EOF){
+		tui_quit();
+	}
+}
+
 int main(void){
 	tui_window* my_child;
+	tui_win_config cfg = { .gravity = TUI_GRAV_LEFT, .width = 20, .height = 10 };
+
 	if (tui_win_make(stdwin, &my_child) != TUI_OK){
 		abort();
 	}
 
-	if (tui_win_set(my_child, TUI_SET_GRAVITY, TUI_GRAV_LEFT) != TUI_OK){
+	if (tui_win_apply(my_child, &cfg, TUI_CFG_GRAVITY | TUI_CFG_WIDTH | TUI_CFG_HEIGHT) != TUI_OK){
 		abort();
 	}
-	tui_win_set(my_child, TUI_SET_WIDTH, 20);
-	tui_win_set(my_child, TUI_SET_HEIGHT, 10);
 
-	tui_show(stdwin);
-	while (1);
+	tui_on_key(on_key, NULL);
+	if (tui_run(stdwin) != TUI_OK){
+		abort();
+	}
+	return 0;
 }
@@ -0,0 +1,74 @@
+/** @file stats.c
+ * @brief Counters for what rendering a frame costs.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "stats.h"
+#include <string.h>
+#include <time.h>
+
+#ifdef TUI_NO_STATS
+static const bool __tui_stats_on = false;
+static tui_frame_stats __tui_stats_cur;
+#else
+bool __tui_stats_on = false;
+tui_frame_stats __tui_stats_cur;
+#endif
+
+static tui_stats stats;
+
+void tui_stats_enable(int enable){
+#ifndef TUI_NO_STATS
+	__tui_stats_on = enable != 0;
+#else
+	(void)enable;
+#endif
+}
+
+void tui_get_stats(tui_stats* out){
+	*out = stats;
+}
+
+void tui_stats_reset(void){
+	memset(&stats, 0, sizeof(stats));
+	memset(&__tui_stats_cur, 0, sizeof(__tui_stats_cur));
+}
+
+uint64_t __tui_stats_now(void){
+	struct timespec ts;
+
+	if (!__tui_stats_on){
+		return 0;
+	}
+#if defined(_WIN32)
+	timespec_get(&ts, TIME_UTC);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void __tui_stats_commit(void){
+	tui_frame_stats* t = &stats.total;
+	tui_frame_stats* c = &__tui_stats_cur;
+
+	if (!__tui_stats_on){
+		return;
+	}
+	t->cells_compared += c->cells_compared;
+	t->cells_emitted += c->cells_emitted;
+	t->bytes += c->bytes;
+	t->writes += c->writes;
+	t->sgr += c->sgr;
+	t->cursor_moves += c->cursor_moves;
+	t->layout_ns += c->layout_ns;
+	t->paint_ns += c->paint_ns;
+	t->flush_ns += c->flush_ns;
+
+	stats.last = *c;
+	stats.frames++;
+	memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,92 @@
+/** @file stats.h
+ * @brief Counters for what rendering a frame costs.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_STATS_H
+#define __TUI_STATS_H
+
+#include "attribute.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief What one or more frames cost.
+ */
+typedef struct tui_frame_stats{
+	uint64_t cells_compared; /**< Cells of the next frame compared against what the terminal shows. */
+	uint64_t cells_emitted;  /**< Cells that differed and were sent. */
+	uint64_t bytes;          /**< Bytes sent to the terminal. */
+	uint64_t writes;         /**< Write syscalls, or calls into the sink for backends without syscalls. */
+	uint64_t sgr;            /**< Attribute changes sent (SGR sequences on ANSI terminals). */
+	uint64_t cursor_moves;   /**< Cursor movements sent. */
+	uint64_t layout_ns;      /**< Time spent laying out windows. */
+	uint64_t paint_ns;       /**< Time spent drawing windows into the framebuffer. */
+	uint64_t flush_ns;       /**< Time spent diffing the framebuffer and sending the result. */
+}tui_frame_stats;
+
+/**
+ * @brief Statistics for the last frame and every frame since they were last reset.
+ * @see tui_get_stats()
+ */
+typedef struct tui_stats{
+	uint64_t frames;       /**< The number of frames counted in total. */
+	tui_frame_stats last;  /**< The last frame shown with tui_show(). A frame that failed counts up to where it stopped. */
+	tui_frame_stats total; /**< Every frame since statistics were enabled or reset. */
+}tui_stats;
+
+/**
+ * Turns statistics on or off.
+ * They are off by default. While they are off, counting costs one predictable branch per counter,
+ * and nothing at all if the library is built with TUI_NO_STATS defined.<br>
+ * Output sent outside of tui_show() counts towards the next frame.
+ *
+ * @param enable Nonzero to count, zero to stop counting.
+ */
+void TUI_API tui_stats_enable(int enable);
+
+/**
+ * Gets the statistics counted so far.
+ *
+ * @param out Filled with the statistics.
+ */
+void TUI_API tui_get_stats(tui_stats* out);
+
+/**
+ * Sets every counter back to zero.
+ */
+void TUI_API tui_stats_reset(void);
+
+#ifdef TUI_NO_STATS
+#define TUI_STAT_ADD(field, n) ((void)sizeof(n))
+#else
+extern bool __tui_stats_on;
+extern tui_frame_stats __tui_stats_cur;
+
+/**
+ * Adds to one of the counters of the frame in progress.
+ */
+#define TUI_STAT_ADD(field, n) \
+	do{ \
+		if (__tui_stats_on){ \
+			__tui_stats_cur.field += (n); \
+		} \
+	}while (0)
+#endif
+
+/**
+ * Gets a monotonic timestamp for timing the parts of a frame.
+ *
+ * @return The time in nanoseconds, or 0 while statistics are off.
+ */
+uint64_t __tui_stats_now(void);
+
+/**
+ * Ends the frame in progress, making it the last frame and adding it to the total.
+ */
+void __tui_stats_commit(void);
+
+#endif
@@ -0,0 +1,156 @@
+/** @file window/border.c
+ * @brief Draws the borders around windows.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "border.h"
+
+#include "../backend.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TUI_BORDER_STYLES (TUI_BORDER_NONE)
+
+/**
+ * @brief The glyphs of each style: top left, top right, bottom left, bottom right, horizontal, vertical.
+ */
+static const char* const border_glyphs[TUI_BORDER_STYLES][6] = {
+	[TUI_BORDER_SINGLE]  = { "┌", "┐", "└", "┘", "─", "│" },
+	[TUI_BORDER_DOUBLE]  = { "╔", "╗", "╚", "╝", "═", "║" },
+	[TUI_BORDER_ROUNDED] = { "╭", "╮", "╰", "╯", "─", "│" },
+	[TUI_BORDER_ASCII]   = { "+", "+", "+", "+", "-", "|" }
+};
+
+/**
+ * @brief A style's glyphs, encoded as cells the first time the style is drawn.
+ */
+static struct tui_border_cache{
+	bool built;
+	tui_cell top_left;
+	tui_cell top_right;
+	tui_cell bot_left;
+	tui_cell bot_right;
+	tui_cell vert;
+
+	/**
+	 * @brief A run of horizontal glyphs as long as the widest border drawn so far.
+	 */
+	tui_cell* horiz;
+	int horiz_len;
+}cache[TUI_BORDER_STYLES];
+
+static bool __tui_contains_nocase(const char* str, const char* needle){
+	size_t len = strlen(needle);
+
+	for (; *str != '\0'; ++str){
+		size_t i;
+		for (i = 0; i < len && tolower((unsigned char)str[i]) == needle[i]; ++i);
+		if (i == len){
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Checks once if the environment's locale is UTF-8, the same way setlocale(LC_ALL, "") would pick it.
+ */
+static bool __tui_border_utf8(void){
+	static int utf8 = -1;
+	const char* vars[] = { "LC_ALL", "LC_CTYPE", "LANG" };
+
+	if (utf8 >= 0){
+		return utf8;
+	}
+	utf8 = 0;
+	for (size_t i = 0; i < sizeof(vars) / sizeof(*vars); ++i){
+		const char* val = getenv(vars[i]);
+		if (val && *val != '\0'){
+			utf8 = __tui_contains_nocase(val, "utf-8") || __tui_contains_nocase(val, "utf8");
+			break;
+		}
+	}
+	return utf8;
+}
+
+static void __tui_border_encode(tui_cell* cell, const char* glyph){
+	memset(cell->glyph, '\0', sizeof(cell->glyph));
+	memcpy(cell->glyph, glyph, strlen(glyph));
+	cell->attr = TUI_NORMAL;
+}
+
+static struct tui_border_cache* __tui_border_get(tui_border style, int width){
+	struct tui_border_cache* c = &cache[style];
+	const char* const* glyphs = border_glyphs[style];
+
+	if (!c->built){
+		__tui_border_encode(&c->top_left, glyphs[0]);
+		__tui_border_encode(&c->top_right, glyphs[1]);
+		__tui_border_encode(&c->bot_left, glyphs[2]);
+		__tui_border_encode(&c->bot_right, glyphs[3]);
+		__tui_border_encode(&c->vert, glyphs[5]);
+		c->built = true;
+	}
+
+	if (width > c->horiz_len){
+		int len = c->horiz_len ? c->horiz_len : 64;
+		tui_cell* tmp;
+
+		while (len < width){
+			len *= 2;
+		}
+		tmp = realloc(c->horiz, (size_t)len * sizeof(*tmp));
+		if (!tmp){
+			return NULL;
+		}
+		__tui_border_encode(&tmp[0], glyphs[4]);
+		for (int i = 1; i < len; ++i){
+			tmp[i] = tmp[0];
+		}
+		c->horiz = tmp;
+		c->horiz_len = len;
+	}
+	return c;
+}
+
+int tui_border_draw(tui_framebuffer* fb, int row1, int col1, int row2, int col2, tui_border style){
+	struct tui_border_cache* c;
+	int inner;
+
+	if (style >= TUI_BORDER_NONE){
+		return 0;
+	}
+	if (!__tui_border_utf8()){
+		style = TUI_BORDER_ASCII;
+	}
+
+	// only the part of the edge that is on the screen is ever copied
+	inner = col2 - col1 - 1;
+	if (inner > fb->cols){
+		inner = fb->cols;
+	}
+	if (!(c = __tui_border_get(style, inner))){
+		return -1;
+	}
+
+	tui_fb_putrun(fb, row1, col1, &c->top_left, 1);
+	tui_fb_putrun(fb, row1, col2, &c->top_right, 1);
+	tui_fb_putrun(fb, row2, col1, &c->bot_left, 1);
+	tui_fb_putrun(fb, row2, col2, &c->bot_right, 1);
+	if (inner > 0){
+		int start = col1 + 1 < 0 ? 0 : col1 + 1;
+		tui_fb_putrun(fb, row1, start, c->horiz, col2 - start);
+		tui_fb_putrun(fb, row2, start, c->horiz, col2 - start);
+	}
+
+	for (int row = (row1 + 1 < 0 ? 0 : row1 + 1); row <= row2 - 1 && row < fb->rows; ++row){
+		tui_fb_putrun(fb, row, col1, &c->vert, 1);
+		tui_fb_putrun(fb, row, col2, &c->vert, 1);
+	}
+	return 0;
+}
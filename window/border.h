@@ -0,0 +1,38 @@
+/** @file window/border.h
+ * @brief Draws the borders around windows.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_WINDOW_BORDER_H
+#define __TUI_WINDOW_BORDER_H
+
+#include "../framebuffer.h"
+
+typedef enum tui_border{
+	TUI_BORDER_SINGLE = 0, /**< ┌─┐ */
+	TUI_BORDER_DOUBLE,     /**< ╔═╗ */
+	TUI_BORDER_ROUNDED,    /**< ╭─╮ */
+	TUI_BORDER_ASCII,      /**< +-+ */
+	TUI_BORDER_NONE        /**< No border at all */
+}tui_border;
+
+/**
+ * Draws a border along the edges of a rectangle.
+ * The glyphs of each style are encoded once and reused, so a horizontal edge is a single tui_fb_putrun().<br>
+ * If the environment's locale is not UTF-8, every style is drawn with TUI_BORDER_ASCII instead.
+ *
+ * @param fb The framebuffer.
+ * @param row1 The top row of the rectangle.
+ * @param col1 The left column of the rectangle.
+ * @param row2 The bottom row of the rectangle, inclusive.
+ * @param col2 The right column of the rectangle, inclusive.
+ * @param style The border style.
+ *
+ * @return 0 on success, negative if out of memory.
+ */
+int tui_border_draw(tui_framebuffer* fb, int row1, int col1, int row2, int col2, tui_border style);
+
+#endif
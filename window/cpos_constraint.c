@@ -0,0 +1,240 @@
+/** @file window/cpos_constraint.c
+ * @brief Positions child windows relative to their siblings using the constraint strategy.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "cpos_constraint.h"
+#include "window.h"
+
+/**
+ * @brief Identifies one solve of one axis, so windows can be marked without clearing the marks afterwards.
+ */
+static unsigned solve_stamp;
+
+static TUI_INLINE int* __tui_lo(tui_container* c, int axis){
+	return axis == TUI_AXIS_X ? &c->col_left : &c->row_top;
+}
+
+static TUI_INLINE int* __tui_hi(tui_container* c, int axis){
+	return axis == TUI_AXIS_X ? &c->col_right : &c->row_bot;
+}
+
+static void __tui_dep_add(struct tui_window* anchor, struct tui_window* win, int axis){
+	win->cons.dep_prev[axis] = NULL;
+	win->cons.dep_next[axis] = anchor->cons.dependents[axis];
+	if (anchor->cons.dependents[axis]){
+		anchor->cons.dependents[axis]->cons.dep_prev[axis] = win;
+	}
+	anchor->cons.dependents[axis] = win;
+}
+
+static void __tui_dep_del(struct tui_window* anchor, struct tui_window* win, int axis){
+	if (win->cons.dep_prev[axis]){
+		win->cons.dep_prev[axis]->cons.dep_next[axis] = win->cons.dep_next[axis];
+	}
+	else{
+		anchor->cons.dependents[axis] = win->cons.dep_next[axis];
+	}
+	if (win->cons.dep_next[axis]){
+		win->cons.dep_next[axis]->cons.dep_prev[axis] = win->cons.dep_prev[axis];
+	}
+	win->cons.dep_next[axis] = NULL;
+	win->cons.dep_prev[axis] = NULL;
+}
+
+static int __tui_cons_axis(int attr_type){
+	return attr_type == TUI_SET_PLACE_LEFTOF || attr_type == TUI_SET_PLACE_RIGHTOF ? TUI_AXIS_X : TUI_AXIS_Y;
+}
+
+int __tui_cons_check(struct tui_window* win, struct tui_window* parent, struct tui_window* anchor, int attr_type){
+	int axis = __tui_cons_axis(attr_type);
+
+	if (!anchor){
+		return TUI_OK;
+	}
+	if (anchor == win || anchor->parent != parent || !parent){
+		return TUI_EINVAL;
+	}
+	// the anchors on one axis have to stay a forest
+	for (struct tui_window* w = anchor->cons.anchor[axis]; w; w = w->cons.anchor[axis]){
+		if (w == win){
+			return TUI_EINVAL;
+		}
+	}
+	return TUI_OK;
+}
+
+int __tui_cons_place(struct tui_window* win, struct tui_window* anchor, int attr_type){
+	int axis = __tui_cons_axis(attr_type);
+	bool before = attr_type == TUI_SET_PLACE_LEFTOF || attr_type == TUI_SET_PLACE_ABOVE;
+	int ret;
+
+	if ((ret = __tui_cons_check(win, win->parent, anchor, attr_type)) != TUI_OK){
+		return ret;
+	}
+
+	if (win->cons.anchor[axis] == anchor && win->cons.before[axis] == before){
+		return TUI_OK;
+	}
+	if (win->cons.anchor[axis]){
+		__tui_dep_del(win->cons.anchor[axis], win, axis);
+	}
+	win->cons.anchor[axis] = anchor;
+	win->cons.before[axis] = before;
+	if (anchor){
+		__tui_dep_add(anchor, win, axis);
+	}
+	__tui_cpos_touch(win);
+	return TUI_OK;
+}
+
+void __tui_cons_detach(struct tui_window* win){
+	for (int axis = TUI_AXIS_X; axis <= TUI_AXIS_Y; ++axis){
+		if (win->cons.anchor[axis]){
+			__tui_dep_del(win->cons.anchor[axis], win, axis);
+			win->cons.anchor[axis] = NULL;
+		}
+		while (win->cons.dependents[axis]){
+			struct tui_window* dep = win->cons.dependents[axis];
+			__tui_dep_del(win, dep, axis);
+			dep->cons.anchor[axis] = NULL;
+			__tui_cpos_touch(dep);
+		}
+	}
+	__tui_cpos_untouch(win);
+}
+
+/**
+ * Computes a window's position on one axis from its anchor, or from its gravity if it has none.
+ * The anchor must already be positioned.
+ */
+static void __tui_cons_solve1(struct tui_window* win, int axis){
+	tui_container* usable = &win->parent->pos.usable;
+	struct tui_window* anchor = win->cons.anchor[axis];
+	int size = axis == TUI_AXIS_X ? win->width : win->height;
+	int ulo = *__tui_lo(usable, axis);
+	int uhi = *__tui_hi(usable, axis);
+	int lo;
+	int hi;
+
+	if (anchor && win->cons.before[axis]){
+		hi = *__tui_lo(&anchor->pos.total, axis) - 1;
+		lo = size == TUI_MATCH_PARENT ? ulo : hi - size;
+	}
+	else if (anchor){
+		lo = *__tui_hi(&anchor->pos.total, axis) + 1;
+		hi = size == TUI_MATCH_PARENT ? uhi : lo + size;
+	}
+	else if (size == TUI_MATCH_PARENT){
+		lo = ulo;
+		hi = uhi;
+	}
+	else if (win->gravity & (axis == TUI_AXIS_X ? TUI_GRAV_LEFT : TUI_GRAV_TOP)){
+		lo = ulo;
+		hi = ulo + size;
+	}
+	else if (win->gravity & (axis == TUI_AXIS_X ? TUI_GRAV_RIGHT : TUI_GRAV_BOT)){
+		lo = uhi - size;
+		hi = uhi;
+	}
+	else{
+		lo = (ulo + uhi) / 2 - size / 2;
+		hi = lo + size;
+	}
+
+	*__tui_lo(&win->pos.total, axis) = lo;
+	*__tui_hi(&win->pos.total, axis) = hi;
+	__tui_calcusablespace(win);
+}
+
+/**
+ * Walks the windows anchored below root on one axis in pre-order, without a stack.
+ * visit returns false to skip a window's dependents.
+ */
+static void __tui_cons_walk(struct tui_window* root, int axis, bool (*visit)(struct tui_window*, int)){
+	struct tui_window* win = root;
+
+	for (;;){
+		if (visit(win, axis) && win->cons.dependents[axis]){
+			win = win->cons.dependents[axis];
+			continue;
+		}
+		while (win != root && !win->cons.dep_next[axis]){
+			win = win->cons.anchor[axis];
+		}
+		if (win == root){
+			return;
+		}
+		win = win->cons.dep_next[axis];
+	}
+}
+
+static bool __tui_cons_mark(struct tui_window* win, int axis){
+	// whoever marked it first also marks everything anchored below it
+	if (win->cons.affected[axis] == solve_stamp){
+		return false;
+	}
+	win->cons.affected[axis] = solve_stamp;
+	return true;
+}
+
+static bool __tui_cons_visit(struct tui_window* win, int axis){
+	__tui_cons_solve1(win, axis);
+	// only the windows solved again can have moved, so the layout looks at nothing else
+	__tui_win_relayout(win);
+	return true;
+}
+
+/**
+ * Positions the changed children and everything anchored below them on one axis.
+ * Each affected window is positioned exactly once, after its anchor.
+ */
+static void __tui_cons_solve_axis(struct tui_window* win, int axis, bool all){
+	solve_stamp++;
+
+	if (all){
+		for (struct tui_window* child = win->children.first; child; child = child->next){
+			child->cons.affected[axis] = solve_stamp;
+		}
+		for (struct tui_window* child = win->children.first; child; child = child->next){
+			if (!child->cons.anchor[axis]){
+				__tui_cons_walk(child, axis, __tui_cons_visit);
+			}
+		}
+		return;
+	}
+
+	for (struct tui_window* p = win->cpos.pending; p; p = p->pending_next){
+		if (p->cons.affected[axis] != solve_stamp){
+			__tui_cons_walk(p, axis, __tui_cons_mark);
+		}
+	}
+	// the top of every affected region is a changed window whose anchor did not change
+	for (struct tui_window* p = win->cpos.pending; p; p = p->pending_next){
+		struct tui_window* anchor = p->cons.anchor[axis];
+		if (!anchor || anchor->cons.affected[axis] != solve_stamp){
+			__tui_cons_walk(p, axis, __tui_cons_visit);
+		}
+	}
+}
+
+int tui_cons_calcchildren(struct tui_window* win){
+	tui_container* usable = &win->pos.usable;
+	tui_container* old = &win->cpos.solved_in;
+	bool all = !win->cpos.solved ||
+		old->row_top != usable->row_top || old->row_bot != usable->row_bot ||
+		old->col_left != usable->col_left || old->col_right != usable->col_right;
+
+	__tui_cons_solve_axis(win, TUI_AXIS_X, all);
+	__tui_cons_solve_axis(win, TUI_AXIS_Y, all);
+
+	while (win->cpos.pending){
+		__tui_cpos_untouch(win->cpos.pending);
+	}
+	win->cpos.solved_in = *usable;
+	win->cpos.solved = true;
+	return TUI_OK;
+}
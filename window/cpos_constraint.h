@@ -0,0 +1,87 @@
+/** @file window/cpos_constraint.h
+ * @brief Positions child windows relative to their siblings using the constraint strategy.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_WINDOW_CPOS_CONSTRAINT
+#define __TUI_WINDOW_CPOS_CONSTRAINT
+
+#include <stdbool.h>
+
+struct tui_window;
+
+#define TUI_AXIS_X (0)
+#define TUI_AXIS_Y (1)
+
+/**
+ * @brief The constraints placing a window relative to its siblings.
+ * Each axis has at most one anchor, so the constraints on one axis form a forest.
+ * Only the windows below a changed window have to be positioned again.
+ */
+typedef struct tui_constraint{
+	/**
+	 * @brief The sibling this window is placed next to on each axis, or NULL if the window uses its gravity on that axis.
+	 */
+	struct tui_window* anchor[2];
+
+	/**
+	 * @brief True if the window goes before its anchor (left of or above), false if it goes after it.
+	 */
+	bool before[2];
+
+	/**
+	 * @brief The first window anchored to this one on each axis.
+	 */
+	struct tui_window* dependents[2];
+
+	/**
+	 * @brief The neighbors of this window in its anchor's dependents list.
+	 */
+	struct tui_window* dep_next[2];
+	struct tui_window* dep_prev[2];
+
+	/**
+	 * @brief The solve that last found this window affected on each axis.
+	 */
+	unsigned affected[2];
+}tui_constraint;
+
+/**
+ * Positions the children of a window using their constraints.
+ * Only the children that changed since the last call and the children placed relative to them are positioned again,
+ * unless the window's usable area changed.<br>
+ * Every child that was positioned is put in the window's relayout list, so tui_layout() only looks at those.
+ *
+ * @param win The window.
+ *
+ * @return TUI_OK
+ */
+int tui_cons_calcchildren(struct tui_window* win);
+
+/**
+ * @brief Do not call this function directly. Use tui_win_set() with TUI_SET_PLACE_* instead.
+ * Places a window next to a sibling, replacing its previous constraint on that axis.
+ *
+ * @return TUI_OK, or TUI_EINVAL if the anchor is not a sibling or the constraint would form a cycle.
+ */
+int __tui_cons_place(struct tui_window* win, struct tui_window* anchor, int attr_type);
+
+/**
+ * @brief Do not call this function directly. Use tui_win_apply() instead.
+ * Checks if a window could be placed next to a sibling once it is a child of parent, without changing anything.
+ *
+ * @return TUI_OK, or TUI_EINVAL if the anchor would not be a sibling or the constraint would form a cycle.
+ */
+int __tui_cons_check(struct tui_window* win, struct tui_window* parent, struct tui_window* anchor, int attr_type);
+
+/**
+ * @brief Do not call this function directly.
+ * Removes every constraint to or from a window before it leaves its parent.
+ * The windows that were placed relative to it go back to their gravity.
+ */
+void __tui_cons_detach(struct tui_window* win);
+
+#endif
@@ -7,67 +7,401 @@
  */
 
 #include "cpos_gravity.h"
+#include "window.h"
+#include <stdint.h>
 
-int tui_grav_calcchildren(tui_window* win){
-	tui_container remaining_area;
-	int ret;
+static int __tui_grav_bucket(tui_gravity g){
+	switch (g){
+	case TUI_GRAV_LEFT:
+		return TUI_GRAV_BUCKET_LEFT;
+	case TUI_GRAV_RIGHT:
+		return TUI_GRAV_BUCKET_RIGHT;
+	case TUI_GRAV_TOP:
+		return TUI_GRAV_BUCKET_TOP;
+	case TUI_GRAV_BOT:
+		return TUI_GRAV_BUCKET_BOT;
+	default:
+		return -1;
+	}
+}
 
-	// get all windows to their right positions before collisions
-	for (size_t i = 0; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
+void __tui_grav_attach(tui_window* win){
+	int b = __tui_grav_bucket(win->gravity);
+	tui_grav_bucket* bucket;
 
-		if (child->width != TUI_MATCH_PARENT){
-			if (child->gravity & TUI_GRAV_LEFT){
-				child->pos.total.col_left = 0;
-				child->pos.total.col_right = child->width;
-			}
-			else if (child->gravity & TUI_GRAV_RIGHT){
-				child->pos.total.col_left = win->pos.usable.col_right - child->width;
-				child->pos.total.col_right = win->pos.usable.col_right;
-			}
-			else{
-				child->pos.total.col_left = (win->pos.usable.col_left + win->pos.usable.col_right) / 2 - child->width / 2;
-				child->pos.total.col_right = child->pos.total.col_left + child->width;
-			}
+	if (b < 0 || !win->parent){
+		return;
+	}
+	bucket = &win->parent->cpos.buckets[b];
+
+	// new children go on top and lowered ones go below everything, so only a gravity change lands in the middle
+	if (bucket->first && win->z < bucket->first->z){
+		win->grav.prev = NULL;
+		win->grav.next = bucket->first;
+		bucket->first->grav.prev = win;
+		bucket->first = win;
+		return;
+	}
+	if (bucket->last && win->z < bucket->last->z){
+		bucket->unsorted = true;
+	}
+	win->grav.prev = bucket->last;
+	win->grav.next = NULL;
+	if (bucket->last){
+		bucket->last->grav.next = win;
+	}
+	else{
+		bucket->first = win;
+	}
+	bucket->last = win;
+}
+
+/**
+ * Merge sorts a list of windows linked through grav.next by z-order. grav.prev is not touched.
+ *
+ * @return The first window of the sorted list.
+ */
+static tui_window* __tui_grav_msort(tui_window* list, size_t len){
+	tui_window* left = list;
+	tui_window* right;
+	tui_window* head = NULL;
+	tui_window** tail = &head;
+	size_t half = len / 2;
+
+	if (len <= 1){
+		return list;
+	}
+	for (size_t i = 1; i < half; ++i){
+		list = list->grav.next;
+	}
+	right = list->grav.next;
+	list->grav.next = NULL;
+
+	left = __tui_grav_msort(left, half);
+	right = __tui_grav_msort(right, len - half);
+	while (left && right){
+		tui_window** next = left->z < right->z ? &left : &right;
+		*tail = *next;
+		tail = &(*next)->grav.next;
+		*next = (*next)->grav.next;
+	}
+	*tail = left ? left : right;
+	return head;
+}
+
+void __tui_grav_sort(tui_window* win){
+	for (int b = 0; b < TUI_GRAV_BUCKETS; ++b){
+		tui_grav_bucket* bucket = &win->cpos.buckets[b];
+		tui_window* prev = NULL;
+		size_t len = 0;
+
+		if (!bucket->unsorted){
+			continue;
+		}
+		for (tui_window* w = bucket->first; w; w = w->grav.next){
+			len++;
+		}
+		bucket->first = __tui_grav_msort(bucket->first, len);
+		for (tui_window* w = bucket->first; w; w = w->grav.next){
+			w->grav.prev = prev;
+			prev = w;
+		}
+		bucket->last = prev;
+		bucket->unsorted = false;
+	}
+}
+
+void __tui_grav_detach(tui_window* win){
+	int b = __tui_grav_bucket(win->gravity);
+	tui_grav_bucket* bucket;
+
+	if (b < 0 || !win->parent){
+		return;
+	}
+	bucket = &win->parent->cpos.buckets[b];
+
+	if (win->grav.prev){
+		win->grav.prev->grav.next = win->grav.next;
+	}
+	else{
+		bucket->first = win->grav.next;
+	}
+	if (win->grav.next){
+		win->grav.next->grav.prev = win->grav.prev;
+		// everything above it in the bucket slides down to fill the gap
+		__tui_cpos_touch(win->grav.next);
+	}
+	else{
+		bucket->last = win->grav.prev;
+	}
+	win->grav.prev = NULL;
+	win->grav.next = NULL;
+}
+
+static TUI_INLINE bool __tui_grav_same(const tui_container* a, const tui_container* b){
+	return a->row_top == b->row_top && a->row_bot == b->row_bot &&
+		a->col_left == b->col_left && a->col_right == b->col_right;
+}
+
+/**
+ * Puts a child where its gravity says, before it is stacked against its siblings.
+ */
+static void __tui_grav_place(tui_window* win, tui_window* child){
+	if (child->width != TUI_MATCH_PARENT){
+		if (child->gravity & TUI_GRAV_LEFT){
+			child->pos.total.col_left = win->pos.usable.col_left;
+			child->pos.total.col_right = win->pos.usable.col_left + child->width;
+		}
+		else if (child->gravity & TUI_GRAV_RIGHT){
+			child->pos.total.col_left = win->pos.usable.col_right - child->width;
+			child->pos.total.col_right = win->pos.usable.col_right;
 		}
+		else{
+			child->pos.total.col_left = (win->pos.usable.col_left + win->pos.usable.col_right) / 2 - child->width / 2;
+			child->pos.total.col_right = child->pos.total.col_left + child->width;
+		}
+	}
 
-		if (child->height != TUI_MATCH_PARENT){
-			if (child->gravity & TUI_GRAV_TOP){
-				child->pos.total.row_top = 0;
-				child->pos.total.row_bot = child->height;
-			}
-			else if (child->gravity & TUI_GRAV_BOT){
-				child->pos.total.row_top = win->pos.usable.row_bot - child->height;
-				child->pos.total.row_bot = win->pos.usable.row_bot;
-			}
-			else{
-				child->pos.total.row_top = (win->pos.usable.row_top + win->pos.usable.row_bot) / 2 - child->height / 2;
-				child->pos.total.row_bot = child->pos.total.row_top + child->height;
-			}
+	if (child->height != TUI_MATCH_PARENT){
+		if (child->gravity & TUI_GRAV_TOP){
+			child->pos.total.row_top = win->pos.usable.row_top;
+			child->pos.total.row_bot = win->pos.usable.row_top + child->height;
+		}
+		else if (child->gravity & TUI_GRAV_BOT){
+			child->pos.total.row_top = win->pos.usable.row_bot - child->height;
+			child->pos.total.row_bot = win->pos.usable.row_bot;
+		}
+		else{
+			child->pos.total.row_top = (win->pos.usable.row_top + win->pos.usable.row_bot) / 2 - child->height / 2;
+			child->pos.total.row_bot = child->pos.total.row_top + child->height;
 		}
 	}
+}
+
+/**
+ * Stretches a child that matches its parent over the space the stacked children left.
+ */
+static void __tui_grav_fill(tui_window* child, const tui_container* remaining){
+	if (child->width == TUI_MATCH_PARENT){
+		child->pos.total.col_left  = remaining->col_left + 1;
+		child->pos.total.col_right = remaining->col_right - 1;
+	}
+	if (child->height == TUI_MATCH_PARENT){
+		child->pos.total.row_top   = remaining->row_top + 1;
+		child->pos.total.row_bot   = remaining->row_bot - 1;
+	}
+	__tui_calcusablespace(child);
+}
+
+static bool __tui_grav_stacked(const tui_window* child, int b){
+	return (b <= TUI_GRAV_BUCKET_RIGHT ? child->width : child->height) != TUI_MATCH_PARENT;
+}
+
+/**
+ * Gets the edge the child after w in bucket b is stacked against.
+ * If w is NULL, or nothing up to it is stacked, this is the edge of the parent.
+ */
+static int __tui_grav_edge(const tui_window* win, int b, const tui_window* w){
+	while (w && !__tui_grav_stacked(w, b)){
+		w = w->grav.prev;
+	}
+	switch (b){
+	case TUI_GRAV_BUCKET_LEFT:
+		return w ? w->pos.total.col_right + 1 : win->pos.usable.col_left;
+	case TUI_GRAV_BUCKET_RIGHT:
+		return w ? w->pos.total.col_left - 1 : win->pos.usable.col_right;
+	case TUI_GRAV_BUCKET_TOP:
+		return w ? w->pos.total.row_bot + 1 : win->pos.usable.row_top;
+	default:
+		return w ? w->pos.total.row_top - 1 : win->pos.usable.row_bot;
+	}
+}
+
+/**
+ * Stacks one child of bucket b against an edge, and moves the edge past it.
+ *
+ * @return True if the child moved.
+ */
+static bool __tui_grav_stack1(tui_window* child, int b, int* edge){
+	int* lo;
+	int* hi;
+	int new_lo;
+	int new_hi;
+
+	switch (b){
+	case TUI_GRAV_BUCKET_LEFT:
+		lo = &child->pos.total.col_left;
+		hi = &child->pos.total.col_right;
+		new_lo = *edge;
+		new_hi = *edge + child->width;
+		*edge = new_hi + 1;
+		break;
+	case TUI_GRAV_BUCKET_RIGHT:
+		lo = &child->pos.total.col_left;
+		hi = &child->pos.total.col_right;
+		new_hi = *edge;
+		new_lo = *edge - child->width;
+		*edge = new_lo - 1;
+		break;
+	case TUI_GRAV_BUCKET_TOP:
+		lo = &child->pos.total.row_top;
+		hi = &child->pos.total.row_bot;
+		new_lo = *edge;
+		new_hi = *edge + child->height;
+		*edge = new_hi + 1;
+		break;
+	default:
+		lo = &child->pos.total.row_top;
+		hi = &child->pos.total.row_bot;
+		new_hi = *edge;
+		new_lo = *edge - child->height;
+		*edge = new_lo - 1;
+		break;
+	}
+	if (*lo == new_lo && *hi == new_hi){
+		return false;
+	}
+	*lo = new_lo;
+	*hi = new_hi;
+	return true;
+}
+
+/**
+ * Stacks bucket b again from start, which is its lowest child that has to be positioned again.
+ * The children above the last changed one stay where they are once one of them does not move.
+ *
+ * @param left The number of children at or above start that have to be positioned again, or SIZE_MAX to stack to the end.
+ */
+static void __tui_grav_restack(tui_window* win, int b, tui_window* start, size_t left){
+	int edge = __tui_grav_edge(win, b, start->grav.prev);
+
+	for (tui_window* child = start; child; child = child->grav.next){
+		bool pending = child->pending;
+
+		if (pending && left != SIZE_MAX){
+			left--;
+		}
+		if (!__tui_grav_stacked(child, b)){
+			continue;
+		}
+		if (__tui_grav_stack1(child, b, &edge) || pending){
+			__tui_calcusablespace(child);
+			__tui_win_relayout(child);
+		}
+		else if (left == 0){
+			break;
+		}
+	}
+}
+
+/**
+ * Positions every child.
+ */
+static int __tui_grav_all(tui_window* win, tui_container* remaining){
+	int ret;
+
+	// get all windows to their right positions before collisions
+	for (tui_window* child = win->children.first; child; child = child->next){
+		__tui_grav_place(win, child);
+	}
 
 	// resolve collisions
-	if ((ret = __tui_solvechildcollisions(win, &remaining_area)) != TUI_OK){
+	__tui_grav_sort(win);
+	if ((ret = __tui_solvechildcollisions(win, remaining)) != TUI_OK){
 		return ret;
 	}
 
 	// set the match_parent window to max size
-	for (size_t i = 0; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
+	for (tui_window* child = win->children.first; child; child = child->next){
+		__tui_grav_fill(child, remaining);
+		__tui_win_relayout(child);
+	}
+	return TUI_OK;
+}
+
+/**
+ * Positions the children that changed, the siblings stacked above them, and the children filling the space left if it changed.
+ */
+static int __tui_grav_some(tui_window* win, tui_container* remaining){
+	tui_grav_bucket* buckets = win->cpos.buckets;
+	tui_window* start[TUI_GRAV_BUCKETS] = { NULL };
+	size_t left[TUI_GRAV_BUCKETS] = { 0 };
 
-		if (child->width == TUI_MATCH_PARENT){
-			child->pos.total.col_left  = remaining_area.col_left + 1;
-			child->pos.total.col_right = remaining_area.col_right - 1;
+	// a bucket a child was put in the middle of is stacked again from the bottom
+	for (int b = 0; b < TUI_GRAV_BUCKETS; ++b){
+		if (buckets[b].unsorted){
+			left[b] = SIZE_MAX;
 		}
-		if (child->height == TUI_MATCH_PARENT){
-			child->pos.total.row_top   = remaining_area.row_top + 1;
-			child->pos.total.row_bot   = remaining_area.row_bot - 1;
+	}
+	__tui_grav_sort(win);
+	for (int b = 0; b < TUI_GRAV_BUCKETS; ++b){
+		if (left[b] == SIZE_MAX){
+			start[b] = buckets[b].first;
 		}
 	}
 
-	for (size_t i = 0; i < win->children.len; ++i){
-		__tui_calcusablespace(win->children.arr[i]);
+	for (tui_window* p = win->cpos.pending; p; p = p->pending_next){
+		int b = __tui_grav_bucket(p->gravity);
+
+		__tui_grav_place(win, p);
+		__tui_win_relayout(p);
+		if (b < 0 || left[b] == SIZE_MAX){
+			continue;
+		}
+		if (!start[b] || p->z < start[b]->z){
+			start[b] = p;
+		}
+		left[b]++;
+	}
+	for (int b = 0; b < TUI_GRAV_BUCKETS; ++b){
+		if (start[b]){
+			__tui_grav_restack(win, b, start[b], left[b]);
+		}
+	}
+
+	remaining->col_left  = __tui_grav_edge(win, TUI_GRAV_BUCKET_LEFT, buckets[TUI_GRAV_BUCKET_LEFT].last);
+	remaining->col_right = __tui_grav_edge(win, TUI_GRAV_BUCKET_RIGHT, buckets[TUI_GRAV_BUCKET_RIGHT].last);
+	remaining->row_top   = __tui_grav_edge(win, TUI_GRAV_BUCKET_TOP, buckets[TUI_GRAV_BUCKET_TOP].last);
+	remaining->row_bot   = __tui_grav_edge(win, TUI_GRAV_BUCKET_BOT, buckets[TUI_GRAV_BUCKET_BOT].last);
+	if (remaining->col_left > remaining->col_right || remaining->row_top > remaining->row_bot){
+		return TUI_ENOSPC;
+	}
+
+	if (!__tui_grav_same(remaining, &win->cpos.remaining)){
+		for (tui_window* child = win->children.first; child; child = child->next){
+			if (child->width == TUI_MATCH_PARENT || child->height == TUI_MATCH_PARENT){
+				__tui_grav_fill(child, remaining);
+				__tui_win_relayout(child);
+			}
+		}
+	}
+	for (tui_window* p = win->cpos.pending; p; p = p->pending_next){
+		__tui_grav_fill(p, remaining);
+	}
+	return TUI_OK;
+}
+
+int tui_grav_calcchildren(tui_window* win){
+	tui_container remaining;
+	int ret;
+
+	// the children only have to be positioned again if they or the space they share changed
+	if (win->cpos.solved && __tui_grav_same(&win->cpos.solved_in, &win->pos.usable)){
+		ret = __tui_grav_some(win, &remaining);
+	}
+	else{
+		ret = __tui_grav_all(win, &remaining);
+	}
+	if (ret != TUI_OK){
+		win->cpos.solved = false;
+		return ret;
+	}
+
+	while (win->cpos.pending){
+		__tui_cpos_untouch(win->cpos.pending);
 	}
+	win->cpos.solved_in = win->pos.usable;
+	win->cpos.remaining = remaining;
+	win->cpos.solved = true;
 	return TUI_OK;
 }
@@ -9,7 +9,9 @@
 #ifndef __TUI_WINDOW_CPOS_GRAVITY
 #define __TUI_WINDOW_CPOS_GRAVITY
 
-#include "window.h"
+#include <stdbool.h>
+
+struct tui_window;
 
 typedef enum tui_gravity{
 	TUI_GRAV_CENTER = 0,
@@ -19,6 +21,65 @@ typedef enum tui_gravity{
 	TUI_GRAV_BOT    = 1 << 3
 }tui_gravity;
 
-int tui_grav_calcchildren(tui_window* win);
+#define TUI_GRAV_BUCKET_LEFT  (0)
+#define TUI_GRAV_BUCKET_RIGHT (1)
+#define TUI_GRAV_BUCKET_TOP   (2)
+#define TUI_GRAV_BUCKET_BOT   (3)
+#define TUI_GRAV_BUCKETS      (4)
+
+/**
+ * @brief The children of a window that are stacked against one of its edges, in z-order.
+ * Only children whose gravity is exactly TUI_GRAV_LEFT, TUI_GRAV_RIGHT, TUI_GRAV_TOP or TUI_GRAV_BOT are stacked.
+ */
+typedef struct tui_grav_bucket{
+	struct tui_window* first;
+	struct tui_window* last;
+
+	/**
+	 * @brief True if a window was put at the end of the bucket instead of in its place.
+	 * The next layout sorts the bucket before stacking it.
+	 */
+	bool unsorted;
+}tui_grav_bucket;
+
+/**
+ * @brief The neighbors of a window in its parent's bucket.
+ */
+typedef struct tui_grav_link{
+	struct tui_window* prev;
+	struct tui_window* next;
+}tui_grav_link;
+
+/**
+ * Positions the children of a window using their gravity.
+ * Only the children that changed since the last call, the siblings stacked against the same edge above them,
+ * and the children that match their parent if the space left for them changed are positioned again, unless the window's usable area changed.<br>
+ * Every child that was positioned is put in the window's relayout list.
+ *
+ * @param win The window.
+ *
+ * @return TUI_OK, or TUI_ENOSPC if the stacked children do not fit.
+ */
+int tui_grav_calcchildren(struct tui_window* win);
+
+/**
+ * @brief Do not call this function directly. It is used by the child positioning strategies.
+ * Sorts the buckets of a window that are out of z-order.
+ */
+void __tui_grav_sort(struct tui_window* win);
+
+/**
+ * @brief Do not call this function directly.
+ * Puts a window into its parent's bucket for its gravity, keeping the bucket in z-order.
+ * This is O(1). A window that goes between two others in the bucket is put at the end,
+ * and the bucket is sorted when it is stacked next.
+ */
+void __tui_grav_attach(struct tui_window* win);
+
+/**
+ * @brief Do not call this function directly.
+ * Takes a window out of its parent's bucket.
+ */
+void __tui_grav_detach(struct tui_window* win);
 
 #endif
@@ -0,0 +1,209 @@
+/** @file window/menu.c
+ * @brief A scrolling list of choices that draws only the entries that are visible.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "menu.h"
+
+#include "../backend.h"
+#include <stdlib.h>
+
+/**
+ * Gets the width of a choice, measuring it if this is the first time it is needed.
+ */
+static size_t __tui_menu_width(tui_menu* menu, size_t i){
+	if (menu->widths[i] == 0){
+		size_t width = tui_fb_width(menu->choices[i], SIZE_MAX);
+		menu->widths[i] = width < UINT32_MAX - 1 ? (uint32_t)width + 1 : UINT32_MAX;
+	}
+	return menu->widths[i] - 1;
+}
+
+/**
+ * Gets the index of the choice shown as entry i.
+ */
+static TUI_INLINE size_t __tui_menu_choice(const tui_menu* menu, size_t i){
+	return menu->view ? menu->view[i] : i;
+}
+
+/**
+ * Gets the index delta entries away from i, stopping at the first and last entry.
+ */
+static size_t __tui_menu_offset(const tui_menu* menu, size_t i, ptrdiff_t delta){
+	if (menu->len == 0){
+		return 0;
+	}
+	if (delta < 0){
+		return (size_t)-delta > i ? 0 : i - (size_t)-delta;
+	}
+	return (size_t)delta >= menu->len - 1 - i ? menu->len - 1 : i + (size_t)delta;
+}
+
+/**
+ * Scrolls just enough to keep the selection visible, and no further than the last page.
+ */
+static void __tui_menu_follow(tui_menu* menu){
+	if (menu->selected < menu->top){
+		menu->top = menu->selected;
+	}
+	if (menu->rows <= 0){
+		return;
+	}
+	if (menu->selected - menu->top >= (size_t)menu->rows){
+		menu->top = menu->selected - (size_t)menu->rows + 1;
+	}
+	if (menu->len <= (size_t)menu->rows){
+		menu->top = 0;
+	}
+	else if (menu->top > menu->len - (size_t)menu->rows){
+		menu->top = menu->len - (size_t)menu->rows;
+	}
+}
+
+static int __tui_menu_draw(tui_window* win, tui_framebuffer* fb, const tui_container* area, void* data){
+	tui_menu* menu = data;
+	int rows = area->row_bot - area->row_top + 1;
+	int cols = area->col_right - area->col_left + 1;
+
+	(void)win;
+	if (rows <= 0 || cols <= 0){
+		return 0;
+	}
+	menu->rows = rows;
+	__tui_menu_follow(menu);
+
+	for (int row = 0; row < rows && menu->top + (size_t)row < menu->len; ++row){
+		size_t i = menu->top + (size_t)row;
+		size_t choice = __tui_menu_choice(menu, i);
+		size_t width = __tui_menu_width(menu, choice);
+		int w = width < (size_t)cols ? (int)width : cols;
+		int col = area->col_left + (menu->flags & TUI_MENU_CENTER ? (cols - w) / 2 : 0);
+		tui_style attr = i == menu->selected ? menu->attr_selected : menu->attr;
+
+		if (i == menu->selected && !(menu->flags & TUI_MENU_HL_TEXT)){
+			for (int c = area->col_left; c <= area->col_right; ++c){
+				tui_fb_putglyph(fb, area->row_top + row, c, " ", attr);
+			}
+		}
+		tui_fb_putsn(fb, area->row_top + row, col, menu->choices[choice], SIZE_MAX, w, attr);
+	}
+	return 0;
+}
+
+int tui_menu_init(tui_menu* menu, tui_window* win, const char* const* choices, size_t len, unsigned flags){
+	menu->widths = NULL;
+	menu->rows = 0;
+	menu->flags = flags;
+	menu->attr = TUI_NORMAL;
+	menu->attr_selected = TUI_INVERT;
+	menu->win = win;
+	if (tui_menu_set_choices(menu, choices, len) != TUI_OK){
+		return TUI_ENOMEM;
+	}
+	tui_win_set_draw(win, __tui_menu_draw, menu);
+	return TUI_OK;
+}
+
+int tui_menu_set_choices(tui_menu* menu, const char* const* choices, size_t len){
+	// zeroed memory is usually handed out untouched, so a huge list only costs the pages that get drawn
+	uint32_t* widths = calloc(len ? len : 1, sizeof(*widths));
+
+	if (!widths){
+		return TUI_ENOMEM;
+	}
+	free(menu->widths);
+	menu->widths = widths;
+	menu->choices = choices;
+	menu->n_choices = len;
+	menu->view = NULL;
+	menu->len = len;
+	menu->selected = 0;
+	menu->top = 0;
+	tui_win_invalidate(menu->win);
+	return TUI_OK;
+}
+
+void tui_menu_set_view(tui_menu* menu, const size_t* indices, size_t len){
+	menu->view = indices;
+	menu->len = indices ? len : menu->n_choices;
+	if (menu->selected >= menu->len){
+		menu->selected = menu->len > 0 ? menu->len - 1 : 0;
+	}
+	__tui_menu_follow(menu);
+	tui_win_invalidate(menu->win);
+}
+
+size_t tui_menu_selected(const tui_menu* menu){
+	return menu->len > 0 ? __tui_menu_choice(menu, menu->selected) : SIZE_MAX;
+}
+
+void tui_menu_free(tui_menu* menu){
+	if (menu->win->draw == __tui_menu_draw && menu->win->draw_data == menu){
+		tui_win_set_draw(menu->win, NULL, NULL);
+	}
+	free(menu->widths);
+	menu->widths = NULL;
+	menu->view = NULL;
+	menu->n_choices = 0;
+	menu->len = 0;
+}
+
+void tui_menu_move(tui_menu* menu, ptrdiff_t delta){
+	tui_menu_select(menu, __tui_menu_offset(menu, menu->selected, delta));
+}
+
+void tui_menu_page(tui_menu* menu, int pages){
+	ptrdiff_t delta = (ptrdiff_t)(menu->rows > 0 ? menu->rows : 1) * pages;
+	size_t top = menu->top;
+	size_t selected = menu->selected;
+
+	menu->top = __tui_menu_offset(menu, top, delta);
+	menu->selected = __tui_menu_offset(menu, selected, delta);
+	__tui_menu_follow(menu);
+	if (menu->top != top || menu->selected != selected){
+		tui_win_invalidate(menu->win);
+	}
+}
+
+void tui_menu_select(tui_menu* menu, size_t i){
+	if (menu->len == 0){
+		return;
+	}
+	if (i >= menu->len){
+		i = menu->len - 1;
+	}
+	if (i == menu->selected){
+		return;
+	}
+	menu->selected = i;
+	__tui_menu_follow(menu);
+	tui_win_invalidate(menu->win);
+}
+
+int tui_menu_key(tui_menu* menu, int key){
+	switch (key){
+	case KEY_UP:
+		tui_menu_move(menu, -1);
+		return 1;
+	case KEY_DOWN:
+		tui_menu_move(menu, 1);
+		return 1;
+	case KEY_PGUP:
+		tui_menu_page(menu, -1);
+		return 1;
+	case KEY_PGDOWN:
+		tui_menu_page(menu, 1);
+		return 1;
+	case KEY_HOME:
+		tui_menu_select(menu, 0);
+		return 1;
+	case KEY_END:
+		tui_menu_select(menu, SIZE_MAX);
+		return 1;
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,173 @@
+/** @file window/menu.h
+ * @brief A scrolling list of choices that draws only the entries that are visible.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_WINDOW_MENU_H
+#define __TUI_WINDOW_MENU_H
+
+#include "window.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define TUI_MENU_CENTER  (1 << 0) /**< Center each entry instead of aligning it to the left. */
+#define TUI_MENU_HL_TEXT (1 << 1) /**< Highlight only the selected entry's text instead of its whole row. */
+
+/**
+ * @brief A menu shown in a window.
+ * The choices are borrowed, not copied, and only the entries that fit in the window are ever looked at,
+ * so moving through the menu takes the same time however many choices there are.
+ */
+typedef struct tui_menu{
+	/**
+	 * @brief The choices. They have to stay valid and unchanged while the menu uses them.
+	 */
+	const char* const* choices;
+	size_t n_choices;
+
+	/**
+	 * @brief The indices of the choices to show, in order, or NULL to show all of them.
+	 * @see tui_menu_set_view()
+	 */
+	const size_t* view;
+
+	/**
+	 * @brief The number of entries shown.
+	 */
+	size_t len;
+
+	/**
+	 * @brief The width of each choice plus one, or 0 if it was not measured yet.
+	 * Choices are measured the first time they are drawn.
+	 */
+	uint32_t* widths;
+
+	/**
+	 * @brief The index of the selected entry.
+	 */
+	size_t selected;
+
+	/**
+	 * @brief The index of the entry on the first visible row.
+	 */
+	size_t top;
+
+	/**
+	 * @brief How many rows the menu had when it was last drawn, or 0 if it wasn't drawn yet.
+	 */
+	int rows;
+
+	/**
+	 * @brief A combination of the TUI_MENU_* flags.
+	 */
+	unsigned flags;
+
+	/**
+	 * @brief The style of the entries, and of the selected entry.
+	 * Call tui_win_invalidate() on the menu's window after changing them.
+	 */
+	tui_style attr;
+	tui_style attr_selected;
+
+	/**
+	 * @brief The window the menu is drawn in.
+	 */
+	tui_window* win;
+}tui_menu;
+
+/**
+ * Makes a window show a menu.
+ * The first choice is selected. Entries are drawn in TUI_NORMAL and the selected one in TUI_INVERT.
+ *
+ * @param menu The menu to initialize.
+ * @param win The window to draw it in. The menu replaces whatever draws the window's contents.
+ * @param choices The choices. The array is not copied, so it has to outlive the menu.
+ * @param len The number of choices.
+ * @param flags A combination of the TUI_MENU_* flags.
+ *
+ * @return TUI_OK on success, or TUI_ENOMEM if out of memory.
+ */
+int tui_menu_init(tui_menu* menu, tui_window* win, const char* const* choices, size_t len, unsigned flags);
+
+/**
+ * Replaces the choices of a menu, and shows all of them.
+ * The first choice is selected.
+ *
+ * @param menu The menu.
+ * @param choices The new choices. The array is not copied, so it has to outlive the menu.
+ * @param len The number of choices.
+ *
+ * @return TUI_OK on success, or TUI_ENOMEM if out of memory. On failure the menu keeps its old choices.
+ */
+int tui_menu_set_choices(tui_menu* menu, const char* const* choices, size_t len);
+
+/**
+ * Shows only some of a menu's choices, such as the ones matching a filter.
+ * The selection stays on the same entry if there still is one, or moves to the last entry otherwise.
+ *
+ * @param menu The menu.
+ * @param indices The indices of the choices to show, in the order to show them, or NULL to show every choice.
+ * The array is not copied, so it has to stay valid until the view is replaced.
+ * @param len The number of indices.
+ */
+void tui_menu_set_view(tui_menu* menu, const size_t* indices, size_t len);
+
+/**
+ * Gets the index of the selected choice.
+ *
+ * @param menu The menu.
+ *
+ * @return The index into the menu's choices, or SIZE_MAX if no entries are shown.
+ */
+size_t tui_menu_selected(const tui_menu* menu);
+
+/**
+ * Frees what a menu allocated and stops its window from drawing it.
+ *
+ * @param menu The menu.
+ */
+void tui_menu_free(tui_menu* menu);
+
+/**
+ * Moves the selection up or down, stopping at the first and last entry.
+ * The menu scrolls just enough to keep the selection visible.
+ *
+ * @param menu The menu.
+ * @param delta How many entries to move down. If negative, the selection moves up instead.
+ */
+void tui_menu_move(tui_menu* menu, ptrdiff_t delta);
+
+/**
+ * Scrolls the menu by whole pages and moves the selection along with it.
+ * A page is as many entries as the window shows.
+ *
+ * @param menu The menu.
+ * @param pages How many pages to scroll down. If negative, the menu scrolls up instead.
+ */
+void tui_menu_page(tui_menu* menu, int pages);
+
+/**
+ * Selects an entry.
+ * The menu scrolls just enough to make it visible.
+ *
+ * @param menu The menu.
+ * @param i The index of the entry, which is also the index of the choice unless tui_menu_set_view() was used.
+ * If it is past the end, the last entry is selected.
+ */
+void tui_menu_select(tui_menu* menu, size_t i);
+
+/**
+ * Handles a key that moves through the menu:
+ * the arrow keys, page up and page down, home and end.
+ *
+ * @param menu The menu.
+ * @param key The key, as returned by tui_getch().
+ *
+ * @return 1 if the key was handled, 0 if it has nothing to do with the menu.
+ */
+int tui_menu_key(tui_menu* menu, int key);
+
+#endif
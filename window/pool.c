@@ -0,0 +1,121 @@
+/** @file window/pool.c
+ * @brief Slab allocator for windows.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "pool.h"
+#include "window.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TUI_SLAB_MIN (64)
+#define TUI_SLAB_MAX (4096)
+
+/**
+ * @brief A block of windows allocated at once.
+ */
+typedef struct tui_slab{
+	struct tui_slab* next;
+	size_t len;
+	tui_window wins[];
+}tui_slab;
+
+static struct tui_pool{
+	/**
+	 * @brief Every slab. They are never freed, because windows from them may still be in use.
+	 */
+	tui_slab* slabs;
+
+	/**
+	 * @brief Windows that are free for reuse, linked through their parent pointer.
+	 */
+	tui_window* free_list;
+
+	/**
+	 * @brief How many windows of the newest slab have never been handed out.
+	 */
+	size_t fresh;
+
+	/**
+	 * @brief The size of the next slab. Slabs grow geometrically so large trees need few of them.
+	 */
+	size_t next_len;
+}pool = { NULL, NULL, 0, TUI_SLAB_MIN };
+
+static int __tui_pool_grow(size_t min){
+	size_t len = pool.next_len;
+	tui_slab* slab;
+
+	while (len < min){
+		len *= 2;
+	}
+	slab = malloc(sizeof(*slab) + len * sizeof(tui_window));
+	if (!slab){
+		return -1;
+	}
+	slab->len = len;
+
+	// the unused remainder of the old slab goes on the free list so it isn't lost
+	if (pool.slabs){
+		for (size_t i = pool.slabs->len - pool.fresh; i < pool.slabs->len; ++i){
+			pool.slabs->wins[i].parent = pool.free_list;
+			pool.free_list = &pool.slabs->wins[i];
+		}
+	}
+
+	slab->next = pool.slabs;
+	pool.slabs = slab;
+	pool.fresh = len;
+	if (pool.next_len < TUI_SLAB_MAX){
+		pool.next_len *= 2;
+	}
+	return 0;
+}
+
+static tui_window* __tui_pool_take(void){
+	tui_window* win;
+
+	if (pool.free_list){
+		win = pool.free_list;
+		pool.free_list = win->parent;
+	}
+	else{
+		win = &pool.slabs->wins[pool.slabs->len - pool.fresh];
+		pool.fresh--;
+	}
+	memset(win, 0, sizeof(*win));
+	return win;
+}
+
+tui_window* __tui_pool_alloc(void){
+	if (!pool.free_list && pool.fresh == 0 && __tui_pool_grow(1) != 0){
+		return NULL;
+	}
+	return __tui_pool_take();
+}
+
+int __tui_pool_alloc_n(size_t n, tui_window** out){
+	size_t available = pool.fresh;
+
+	// count the free list only as far as needed
+	for (tui_window* w = pool.free_list; w && available < n; w = w->parent){
+		available++;
+	}
+	if (available < n && __tui_pool_grow(n - pool.fresh) != 0){
+		return -1;
+	}
+
+	for (size_t i = 0; i < n; ++i){
+		out[i] = __tui_pool_take();
+	}
+	return 0;
+}
+
+void __tui_pool_free(tui_window* win){
+	win->parent = pool.free_list;
+	pool.free_list = win;
+}
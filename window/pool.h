@@ -0,0 +1,38 @@
+/** @file window/pool.h
+ * @brief Slab allocator for windows.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_WINDOW_POOL_H
+#define __TUI_WINDOW_POOL_H
+
+#include <stddef.h>
+
+struct tui_window;
+
+/**
+ * @brief Do not call this function directly. Use tui_win_make() instead.
+ * Gets a zeroed window from the pool.
+ *
+ * @return The window, or NULL if out of memory.
+ */
+struct tui_window* __tui_pool_alloc(void);
+
+/**
+ * @brief Do not call this function directly. Use tui_win_make_n() instead.
+ * Gets n zeroed windows from the pool. Either all of them are allocated or none are.
+ *
+ * @return 0 on success, negative if out of memory.
+ */
+int __tui_pool_alloc_n(size_t n, struct tui_window** out);
+
+/**
+ * @brief Do not call this function directly. Use tui_win_free() instead.
+ * Returns a window to the pool.
+ */
+void __tui_pool_free(struct tui_window* win);
+
+#endif
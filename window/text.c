@@ -0,0 +1,191 @@
+/** @file window/text.c
+ * @brief A block of text that wraps to the width of its window.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "text.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Gets the index of the byte after the character that starts at i.
+ */
+static TUI_INLINE size_t __tui_text_next(const tui_text* text, size_t i){
+	do{
+		i++;
+	}while (i < text->len && ((unsigned char)text->text[i] & 0xC0) == 0x80);
+	return i;
+}
+
+/**
+ * Adds a line, leaving out the spaces and carriage return at its end.
+ *
+ * @return TUI_OK on success, or TUI_ENOMEM if out of memory.
+ */
+static int __tui_text_push(tui_text* text, size_t start, size_t end, int width){
+	while (end > start && (text->text[end - 1] == ' ' || text->text[end - 1] == '\r')){
+		end--;
+		width--;
+	}
+
+	if (text->n_lines >= text->cap_lines){
+		size_t cap = text->cap_lines ? text->cap_lines * 2 : 16;
+		tui_text_line* lines = realloc(text->lines, cap * sizeof(*lines));
+
+		if (!lines){
+			return TUI_ENOMEM;
+		}
+		text->lines = lines;
+		text->cap_lines = cap;
+	}
+	text->lines[text->n_lines].off = start;
+	text->lines[text->n_lines].len = end - start;
+	text->lines[text->n_lines].width = width;
+	text->n_lines++;
+	return TUI_OK;
+}
+
+/**
+ * Breaks the text between two newlines into lines of at most width cells.
+ *
+ * @return TUI_OK on success, or TUI_ENOMEM if out of memory.
+ */
+static int __tui_text_wrap_para(tui_text* text, size_t start, size_t end, int width){
+	const char* s = text->text;
+
+	do{
+		size_t i = start;
+		size_t brk = start;
+		int brk_width = 0;
+		int col = 0;
+		int ret;
+
+		while (i < end && col < width){
+			if (s[i] == ' '){
+				brk = i;
+				brk_width = col;
+			}
+			i = __tui_text_next(text, i);
+			col++;
+		}
+
+		if (i >= end){
+			return __tui_text_push(text, start, end, col);
+		}
+		if (s[i] == ' ' || brk == start){
+			// the line ends right before a space, or the word is too long to wrap anywhere else
+			ret = __tui_text_push(text, start, i, col);
+			start = i;
+		}
+		else{
+			ret = __tui_text_push(text, start, brk, brk_width);
+			start = brk + 1;
+		}
+		if (ret != TUI_OK){
+			return ret;
+		}
+
+		while (start < end && s[start] == ' '){
+			start++;
+		}
+	}while (start < end);
+	return TUI_OK;
+}
+
+int tui_text_wrap(tui_text* text, int width){
+	size_t start = 0;
+
+	if (width < 1){
+		return TUI_EINVAL;
+	}
+	if (width == text->width){
+		return TUI_OK;
+	}
+
+	text->n_lines = 0;
+	text->width = -1;
+	while (start < text->len){
+		const char* nl = memchr(text->text + start, '\n', text->len - start);
+		size_t end = nl ? (size_t)(nl - text->text) : text->len;
+
+		if (__tui_text_wrap_para(text, start, end, width) != TUI_OK){
+			return TUI_ENOMEM;
+		}
+		start = end + 1;
+	}
+	text->width = width;
+	return TUI_OK;
+}
+
+static int __tui_text_draw(tui_window* win, tui_framebuffer* fb, const tui_container* area, void* data){
+	tui_text* text = data;
+	int rows = area->row_bot - area->row_top + 1;
+	int cols = area->col_right - area->col_left + 1;
+	int row = area->row_top;
+
+	(void)win;
+	if (rows <= 0 || cols <= 0){
+		return 0;
+	}
+	if (tui_text_wrap(text, cols) != TUI_OK){
+		return TUI_ENOMEM;
+	}
+
+	if (text->flags & TUI_TEXT_MIDDLE && text->n_lines < (size_t)rows){
+		row += (rows - (int)text->n_lines) / 2;
+	}
+	for (size_t i = 0; i < text->n_lines && row <= area->row_bot; ++i, ++row){
+		const tui_text_line* line = &text->lines[i];
+		int col = area->col_left;
+
+		if (text->flags & TUI_TEXT_RIGHT){
+			col += cols - line->width;
+		}
+		else if (text->flags & TUI_TEXT_CENTER){
+			col += (cols - line->width) / 2;
+		}
+		tui_fb_putsn(fb, row, col, text->text + line->off, line->len, line->width, text->attr);
+	}
+	return 0;
+}
+
+void tui_text_init(tui_text* text, tui_window* win, const char* str, size_t len, unsigned flags){
+	text->lines = NULL;
+	text->n_lines = 0;
+	text->cap_lines = 0;
+	text->flags = flags;
+	text->attr = TUI_NORMAL;
+	text->win = win;
+	tui_text_set(text, str, len);
+	tui_win_set_draw(win, __tui_text_draw, text);
+}
+
+void tui_text_set(tui_text* text, const char* str, size_t len){
+	text->text = str;
+	text->len = strnlen(str, len);
+	text->width = -1;
+	tui_win_invalidate(text->win);
+}
+
+void tui_text_set_flags(tui_text* text, unsigned flags){
+	if (flags == text->flags){
+		return;
+	}
+	text->flags = flags;
+	tui_win_invalidate(text->win);
+}
+
+void tui_text_free(tui_text* text){
+	if (text->win->draw == __tui_text_draw && text->win->draw_data == text){
+		tui_win_set_draw(text->win, NULL, NULL);
+	}
+	free(text->lines);
+	text->lines = NULL;
+	text->n_lines = 0;
+	text->cap_lines = 0;
+	text->width = -1;
+}
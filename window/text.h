@@ -0,0 +1,116 @@
+/** @file window/text.h
+ * @brief A block of text that wraps to the width of its window.
+ * @copyright Copyright (c) 2018 Jonathan Lemos
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef __TUI_WINDOW_TEXT_H
+#define __TUI_WINDOW_TEXT_H
+
+#include "window.h"
+#include <stddef.h>
+
+#define TUI_TEXT_CENTER (1 << 0) /**< Center each line instead of aligning it to the left. */
+#define TUI_TEXT_RIGHT  (1 << 1) /**< Align each line to the right instead of the left. */
+#define TUI_TEXT_MIDDLE (1 << 2) /**< Center the block vertically instead of starting at the top. */
+
+/**
+ * @brief A line of a text block, as a slice of its text.
+ */
+typedef struct tui_text_line{
+	size_t off;
+	size_t len;
+	int width;
+}tui_text_line;
+
+/**
+ * @brief A block of text shown in a window.
+ * The text is borrowed, not copied. Lines end at each newline, and wrap at the last space that fits, or mid-word if none does.<br>
+ * Where the lines break is worked out once for the width of the window, and only again when the text or the width changes.
+ */
+typedef struct tui_text{
+	/**
+	 * @brief The text. It has to stay valid and unchanged while the block uses it.
+	 */
+	const char* text;
+	size_t len;
+
+	/**
+	 * @brief The lines the text breaks into at the width below.
+	 */
+	tui_text_line* lines;
+	size_t n_lines;
+	size_t cap_lines;
+
+	/**
+	 * @brief The width the lines were broken at, or -1 if they need to be broken again.
+	 */
+	int width;
+
+	/**
+	 * @brief A combination of the TUI_TEXT_* flags.
+	 */
+	unsigned flags;
+
+	/**
+	 * @brief The style of the text.
+	 * Call tui_win_invalidate() on the block's window after changing it.
+	 */
+	tui_style attr;
+
+	/**
+	 * @brief The window the block is drawn in.
+	 */
+	tui_window* win;
+}tui_text;
+
+/**
+ * Makes a window show a block of text.
+ * The text is drawn in TUI_NORMAL. Lines that don't fit in the window are not drawn.
+ *
+ * @param text The block to initialize.
+ * @param win The window to draw it in. The block replaces whatever draws the window's contents.
+ * @param str The text, in UTF-8. It is not copied, so it has to outlive the block.
+ * @param len The maximum number of bytes to use. The text also ends at a null byte.
+ * @param flags A combination of the TUI_TEXT_* flags.
+ */
+void tui_text_init(tui_text* text, tui_window* win, const char* str, size_t len, unsigned flags);
+
+/**
+ * Replaces the text of a block.
+ *
+ * @param text The block.
+ * @param str The new text, in UTF-8. It is not copied, so it has to outlive the block.
+ * @param len The maximum number of bytes to use. The text also ends at a null byte.
+ */
+void tui_text_set(tui_text* text, const char* str, size_t len);
+
+/**
+ * Changes how a block is aligned.
+ *
+ * @param text The block.
+ * @param flags A combination of the TUI_TEXT_* flags.
+ */
+void tui_text_set_flags(tui_text* text, unsigned flags);
+
+/**
+ * Breaks a block's text into lines of at most a given width, unless it was already broken at that width.
+ * Drawing does this on its own. Call it to find out how many rows the text needs before sizing its window.
+ *
+ * @param text The block.
+ * @param width The maximum number of cells in a line.
+ *
+ * @return TUI_OK on success, TUI_ENOMEM if out of memory, or TUI_EINVAL if width is less than 1.
+ */
+int tui_text_wrap(tui_text* text, int width);
+
+/**
+ * Frees what a block allocated and stops its window from drawing it.
+ *
+ * @param text The block.
+ */
+void tui_text_free(tui_text* text);
+
+#endif
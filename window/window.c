@@ -8,143 +8,190 @@
 
 #include "window.h"
 
+#include "border.h"
+#include "pool.h"
 #include "backend.h"
-#include <locale.h>
+#include "framebuffer.h"
+#include "stats.h"
 #include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-int __tui_addchild(tui_window* parent, tui_window* child){
-	tui_window** tmp;
-	for (size_t i = 0; i < parent->children.len; ++i){
-		if (parent->children.arr[i] == child){
-			return TUI_OK;
-		}
+void __tui_cpos_touch(tui_window* win){
+	tui_window* parent = win->parent;
+
+	if (!parent || win->pending){
+		return;
 	}
+	win->pending = true;
+	win->pending_prev = NULL;
+	win->pending_next = parent->cpos.pending;
+	if (parent->cpos.pending){
+		parent->cpos.pending->pending_prev = win;
+	}
+	parent->cpos.pending = win;
+}
 
-	(parent->children.len)++;
-	tmp = realloc(parent->children.arr, parent->children.len * sizeof(*(parent->children.arr)));
-	if (!tmp){
-		(parent->children.len)--;
-		return TUI_ENOMEM;
+void __tui_cpos_untouch(tui_window* win){
+	if (!win->pending){
+		return;
+	}
+	if (win->pending_prev){
+		win->pending_prev->pending_next = win->pending_next;
+	}
+	else{
+		win->parent->cpos.pending = win->pending_next;
+	}
+	if (win->pending_next){
+		win->pending_next->pending_prev = win->pending_prev;
 	}
-	parent->children.arr = tmp;
+	win->pending = false;
+	win->pending_next = NULL;
+	win->pending_prev = NULL;
+}
 
-	parent->children.arr[parent->children.len - 1] = child;
-	return TUI_OK;
+void __tui_cpos_reset(tui_window* win){
+	while (win->cpos.pending){
+		__tui_cpos_untouch(win->cpos.pending);
+	}
+	win->cpos.solved = false;
 }
 
-int __tui_delchild(tui_window* parent, tui_window* child){
-	tui_window** tmp;
-	size_t i;
-	for (i = 0; i < parent->children.len; ++i){
-		if (parent->children.arr[i] == child){
-			break;
-		}
+void __tui_win_relayout(tui_window* win){
+	tui_window* parent = win->parent;
+
+	if (!parent || win->relayout_queued){
+		return;
 	}
-	if (i == parent->children.len){
-		return TUI_EINVAL;
+	win->relayout_queued = true;
+	win->relayout_prev = NULL;
+	win->relayout_next = parent->relayout;
+	if (parent->relayout){
+		parent->relayout->relayout_prev = win;
 	}
+	parent->relayout = win;
+}
 
-	for (; i < parent->children.len; ++i){
-		parent->children.arr[i] = parent->children.arr[i + 1];
+static void __tui_win_unrelayout(tui_window* win){
+	if (!win->relayout_queued){
+		return;
 	}
+	if (win->relayout_prev){
+		win->relayout_prev->relayout_next = win->relayout_next;
+	}
+	else{
+		win->parent->relayout = win->relayout_next;
+	}
+	if (win->relayout_next){
+		win->relayout_next->relayout_prev = win->relayout_prev;
+	}
+	win->relayout_queued = false;
+	win->relayout_next = NULL;
+	win->relayout_prev = NULL;
+}
 
-	(parent->children.len)--;
-	tmp = realloc(parent->children.arr, parent->children.len * sizeof(*(parent->children.arr)));
-	if (!tmp){
-		(parent->children.len)++;
-		return TUI_ENOMEM;
+/**
+ * Makes the next layout reach a window, by putting it and every ancestor that is not there yet in their parents' relayout lists.
+ */
+static void __tui_win_relayout_up(tui_window* win){
+	// an ancestor that is already queued has the rest of the path queued too
+	for (; win->parent && !win->relayout_queued; win = win->parent){
+		__tui_win_relayout(win);
 	}
+}
 
-	return TUI_OK;
+/**
+ * Puts a window on top of a parent's children.
+ * The window must not have a parent.
+ */
+static void __tui_link(tui_window* parent, tui_window* child){
+	child->parent = parent;
+	child->z = parent->children.last ? parent->children.last->z + 1 : 0;
+	child->prev = parent->children.last;
+	child->next = NULL;
+	if (parent->children.last){
+		parent->children.last->next = child;
+	}
+	else{
+		parent->children.first = child;
+	}
+	parent->children.last = child;
+	parent->children.len++;
+	__tui_grav_attach(child);
+	__tui_cpos_touch(child);
 }
 
-int __tui_solvechildcollisions(tui_window* win, struct tui_container* out){
-	int left_edge  = 0;
-	int right_edge = win->pos.usable.col_right - 1;
-	int top_edge   = 0;
-	int bot_edge   = win->pos.usable.row_bot - 1;
-	size_t i;
-
-	// left
-	for (i = 0; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		if (child->gravity == TUI_GRAV_LEFT){
-			left_edge = child->pos.total.col_right + 1;
-			i++;
-			break;
-		}
+/**
+ * Takes a window out of its parent's children.
+ */
+static void __tui_unlink(tui_window* child){
+	tui_window* parent = child->parent;
+
+	__tui_grav_detach(child);
+	__tui_cpos_untouch(child);
+	__tui_win_unrelayout(child);
+
+	if (child->prev){
+		child->prev->next = child->next;
+	}
+	else{
+		parent->children.first = child->next;
+	}
+	if (child->next){
+		child->next->prev = child->prev;
+	}
+	else{
+		parent->children.last = child->prev;
 	}
-	for (; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		if (child->gravity != TUI_GRAV_LEFT){
+	parent->children.len--;
+	child->parent = NULL;
+	child->prev = NULL;
+	child->next = NULL;
+}
+
+int __tui_solvechildcollisions(tui_window* win, struct tui_container* out){
+	tui_grav_bucket* buckets = win->cpos.buckets;
+	int left_edge  = win->pos.usable.col_left;
+	int right_edge = win->pos.usable.col_right;
+	int top_edge   = win->pos.usable.row_top;
+	int bot_edge   = win->pos.usable.row_bot;
+
+	// each edge only visits the children stacked against it. children that fill their parent on that axis are not stacked
+	for (tui_window* child = buckets[TUI_GRAV_BUCKET_LEFT].first; child; child = child->grav.next){
+		if (child->width == TUI_MATCH_PARENT){
 			continue;
 		}
-		child->pos.total.col_left  += left_edge;
-		child->pos.total.col_right += left_edge;
+		child->pos.total.col_left  = left_edge;
+		child->pos.total.col_right = left_edge + child->width;
 		left_edge = child->pos.total.col_right + 1;
 	}
 
-	// right
-	for (i = 0; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		if (child->gravity == TUI_GRAV_RIGHT){
-			right_edge = child->pos.total.col_left - 1;
-			i++;
-			break;
-		}
-	}
-	for (; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		size_t diff;
-		if (child->gravity != TUI_GRAV_RIGHT){
+	for (tui_window* child = buckets[TUI_GRAV_BUCKET_RIGHT].first; child; child = child->grav.next){
+		if (child->width == TUI_MATCH_PARENT){
 			continue;
 		}
-		diff = child->pos.total.col_right - child->pos.total.col_left;
-		child->pos.total.col_left  = right_edge - diff;
 		child->pos.total.col_right = right_edge;
+		child->pos.total.col_left  = right_edge - child->width;
 		right_edge = child->pos.total.col_left - 1;
 	}
 
-	// top
-	for (i = 0; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		if (child->gravity == TUI_GRAV_TOP){
-			top_edge = child->pos.total.row_bot + 1;
-			i++;
-			break;
-		}
-	}
-	for (; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		if (child->gravity != TUI_GRAV_TOP){
+	for (tui_window* child = buckets[TUI_GRAV_BUCKET_TOP].first; child; child = child->grav.next){
+		if (child->height == TUI_MATCH_PARENT){
 			continue;
 		}
-		child->pos.total.row_top += top_edge;
-		child->pos.total.row_bot += top_edge;
+		child->pos.total.row_top = top_edge;
+		child->pos.total.row_bot = top_edge + child->height;
 		top_edge = child->pos.total.row_bot + 1;
 	}
 
-	// bottom
-	for (i = 0; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		if (child->gravity == TUI_GRAV_BOT){
-			bot_edge = child->pos.total.row_top - 1;
-			i++;
-			break;
-		}
-	}
-	for (; i < win->children.len; ++i){
-		tui_window* child = win->children.arr[i];
-		size_t diff;
-		if (child->gravity != TUI_GRAV_RIGHT){
+	for (tui_window* child = buckets[TUI_GRAV_BUCKET_BOT].first; child; child = child->grav.next){
+		if (child->height == TUI_MATCH_PARENT){
 			continue;
 		}
-		diff = child->pos.total.row_top - child->pos.total.row_bot;
-		child->pos.total.row_top = bot_edge - diff;
 		child->pos.total.row_bot = bot_edge;
+		child->pos.total.row_top = bot_edge - child->height;
 		bot_edge = child->pos.total.row_top - 1;
 	}
 
@@ -160,7 +207,7 @@ int __tui_solvechildcollisions(tui_window* win, struct tui_container* out){
 	return TUI_OK;
 }
 
-static int __tui_calcusablespace(tui_window* win){
+int __tui_calcusablespace(tui_window* win){
 	win->pos.usable.col_left  = win->pos.total.col_left + win->x_padding;
 	win->pos.usable.col_right = win->pos.total.col_right - win->x_padding;
 	win->pos.usable.row_top   = win->pos.total.row_top + win->y_padding;
@@ -168,6 +215,27 @@ static int __tui_calcusablespace(tui_window* win){
 	return TUI_OK;
 }
 
+void __tui_win_dirty(tui_window* win, unsigned flags){
+	win->dirty |= flags;
+	if (flags & TUI_DIRTY_LAYOUT){
+		__tui_win_relayout_up(win);
+	}
+
+	// stop at the first ancestor that already knows, because everything above it knows too
+	for (win = win->parent; win && !(win->dirty & TUI_DIRTY_DESCENDANT); win = win->parent){
+		win->dirty |= TUI_DIRTY_DESCENDANT;
+	}
+}
+
+static void __tui_stdwin_resize(tui_window* win, int rows, int cols){
+	win->pos.total.col_left  = 0;
+	win->pos.total.col_right = cols - 1;
+	win->pos.total.row_top   = 0;
+	win->pos.total.row_bot   = rows - 1;
+	__tui_calcusablespace(win);
+	__tui_win_dirty(win, TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT);
+}
+
 TUI_CONST tui_window* __getstdwin(void){
 	static tui_window tui;
 	static bool initialized = false;
@@ -179,51 +247,69 @@ TUI_CONST tui_window* __getstdwin(void){
 		tui.x_padding    = 0;
 		tui.y_padding    = 0;
 		tui.parent       = NULL;
-		tui.children.arr = NULL;
+		tui.children.first = NULL;
+		tui.children.last = NULL;
 		tui.children.len = 0;
-		tui.pos.total.col_left   = 0;
-		tui.pos.total.col_right  = tui_getcols() - 1;
-		tui.pos.total.row_top    = 0;
-		tui.pos.total.row_bot    = tui_getrows() - 1;
-		tui.pos.usable.col_left  = 0;
-		tui.pos.usable.col_right = tui_getcols() - 1;
-		tui.pos.usable.row_top   = 0;
-		tui.pos.usable.row_bot   = tui_getrows() - 1;
+		__tui_stdwin_resize(&tui, tui_getrows(), tui_getcols());
 	}
 	initialized = true;
 
 	return &tui;
 }
 
-static void print_box(tui_window* win){
-	const char* locale = setlocale(LC_ALL, NULL);
-	size_t row1 = win->pos.total.row_top;
-	size_t row2 = win->pos.total.row_bot;
-	size_t col1 = win->pos.total.col_left;
-	size_t col2 = win->pos.total.col_right;
+/**
+ * @brief What the screen should look like after the next tui_show().
+ */
+static tui_framebuffer screen;
 
-	setlocale(LC_ALL, "");
-	tui_setcursorpos(row1, col1);
-	printf("%s", "┌");
-	for (size_t i = col1 + 1; i <= col2 - 1; ++i){
-		printf("%s", "─");
-	}
-	printf("%s", "┐");
-	for (size_t i = row1 + 1; i <= row2 - 1; ++i){
-		tui_setcursorpos(i, col1);
-		printf("%s", "│");
-		tui_setcursorpos(i, col2);
-		printf("%s", "│");
+/**
+ * @brief The window shown by the last tui_show().
+ * If a different window is shown, everything has to be drawn again.
+ */
+static tui_window* screen_root;
+
+/**
+ * @brief The backend the screen was last sent to.
+ */
+static const tui_backend* screen_backend;
+
+static int __tui_syncscreen(void){
+	int rows = tui_getrows();
+	int cols = tui_getcols();
+
+	// a different backend shows none of what the front buffer holds
+	if (tui_get_backend() != screen_backend){
+		screen_backend = tui_get_backend();
+		tui_fb_invalidate(&screen);
 	}
-	tui_setcursorpos(row2, col1);
-	printf("%s", "└");
-	for (size_t i = col1 + 1; i <= col2 - 1; ++i){
-		printf("%s", "─");
+
+	if (screen.back && rows == screen.rows && cols == screen.cols){
+		return TUI_OK;
 	}
-	printf("%s", "┘");
-	fflush(stdout);
 
-	setlocale(LC_ALL, locale);
+	// the terminal was resized, so stdwin has to follow it before the layout runs
+	__tui_stdwin_resize(stdwin, rows, cols);
+	screen_root = NULL;
+	return tui_fb_resize(&screen, rows, cols) == 0 ? TUI_OK : TUI_ENOMEM;
+}
+
+static int print_box(tui_window* win){
+	return tui_border_draw(&screen, win->pos.total.row_top, win->pos.total.col_left, win->pos.total.row_bot, win->pos.total.col_right, win->border);
+}
+
+static int print_content(tui_window* win){
+	tui_container area = win->pos.usable;
+
+	if (!win->draw){
+		return 0;
+	}
+	if (win->border != TUI_BORDER_NONE){
+		area.row_top++;
+		area.row_bot--;
+		area.col_left++;
+		area.col_right--;
+	}
+	return win->draw(win, &screen, &area, win->draw_data);
 }
 
 TUI_CONST const char* tui_strerr(int tuie){
@@ -238,13 +324,15 @@ TUI_CONST const char* tui_strerr(int tuie){
 		return "Bad attribute type given to tui_win_set()";
 	case TUI_ENOSPC:
 		return "Not enough space on the screen";
+	case TUI_EIO:
+		return "Failed to write to the terminal";
 	default:
 		return "Unknown error. This is a bug.";
 	}
 }
 
 int tui_win_make(tui_window* parent, tui_window** out){
-	tui_window* ret = calloc(1, sizeof(*ret));
+	tui_window* ret = __tui_pool_alloc();
 	if (!ret){
 		return TUI_ENOMEM;
 	}
@@ -252,96 +340,544 @@ int tui_win_make(tui_window* parent, tui_window** out){
 	if (!parent){
 		parent = stdwin;
 	}
-	__tui_addchild(parent, ret);
+	__tui_link(parent, ret);
+	__tui_win_dirty(parent, TUI_DIRTY_LAYOUT);
 
 	*out = ret;
 	return TUI_OK;
 }
 
+int tui_win_make_n(tui_window* parent, size_t n, tui_window** out){
+	if (!parent){
+		parent = stdwin;
+	}
+	if (n == 0){
+		return TUI_OK;
+	}
+
+	if (__tui_pool_alloc_n(n, out) != 0){
+		return TUI_ENOMEM;
+	}
+	for (size_t i = 0; i < n; ++i){
+		__tui_link(parent, out[i]);
+	}
+	__tui_win_dirty(parent, TUI_DIRTY_LAYOUT);
+	return TUI_OK;
+}
+
+/**
+ * A window's size or gravity changed, so it and its siblings have to be positioned again.
+ */
+static void __tui_win_geometry_changed(tui_window* win){
+	if (win->parent){
+		__tui_cpos_touch(win);
+		__tui_win_dirty(win->parent, TUI_DIRTY_LAYOUT);
+	}
+	else{
+		__tui_win_dirty(win, TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT);
+	}
+}
+
+/**
+ * Gets the field of tui_win_config for one of the TUI_SET_PLACE_* attributes.
+ */
+static tui_window* __tui_cfg_place(const tui_win_config* cfg, int attr_type){
+	switch (attr_type){
+	case TUI_SET_PLACE_LEFTOF:
+		return cfg->leftof;
+	case TUI_SET_PLACE_RIGHTOF:
+		return cfg->rightof;
+	case TUI_SET_PLACE_ABOVE:
+		return cfg->above;
+	default:
+		return cfg->below;
+	}
+}
+
+static int __tui_win_validate(tui_window* win, tui_window* parent, const tui_win_config* cfg, unsigned mask){
+	if (mask & ~TUI_CFG_ALL){
+		return TUI_SET_BADATTR;
+	}
+	if ((mask & TUI_CFG_GRAVITY) &&
+		(((cfg->gravity & TUI_GRAV_LEFT) && (cfg->gravity & TUI_GRAV_RIGHT)) ||
+		((cfg->gravity & TUI_GRAV_TOP)  && (cfg->gravity & TUI_GRAV_BOT)))){
+		return TUI_EINVAL;
+	}
+	if (mask & TUI_CFG_PARENT){
+		// a window cannot become its own descendant
+		for (tui_window* w = parent; w; w = w->parent){
+			if (w == win){
+				return TUI_EINVAL;
+			}
+		}
+	}
+	if (((mask & TUI_CFG_WIDTH) && cfg->width < TUI_MATCH_PARENT) ||
+		((mask & TUI_CFG_HEIGHT) && cfg->height < TUI_MATCH_PARENT) ||
+		((mask & TUI_CFG_X_PADDING) && cfg->x_padding < 0) ||
+		((mask & TUI_CFG_Y_PADDING) && cfg->y_padding < 0) ||
+		((mask & TUI_CFG_CPOS) && cfg->cpos != TUI_CPOS_GRAVITY && cfg->cpos != TUI_CPOS_CONSTRAINT) ||
+		((mask & TUI_CFG_BORDER) && (cfg->border < TUI_BORDER_SINGLE || cfg->border > TUI_BORDER_NONE))){
+		return TUI_EINVAL;
+	}
+
+	// one constraint per axis
+	if (((mask & TUI_CFG_PLACE_LEFTOF) && (mask & TUI_CFG_PLACE_RIGHTOF)) ||
+		((mask & TUI_CFG_PLACE_ABOVE) && (mask & TUI_CFG_PLACE_BELOW))){
+		return TUI_EINVAL;
+	}
+	for (int attr = TUI_SET_PLACE_LEFTOF; attr <= TUI_SET_PLACE_BELOW; ++attr){
+		if ((mask & (1u << attr)) && __tui_cons_check(win, parent, __tui_cfg_place(cfg, attr), attr) != TUI_OK){
+			return TUI_EINVAL;
+		}
+	}
+	return TUI_OK;
+}
+
+int tui_win_apply(tui_window* win, const tui_win_config* cfg, unsigned mask){
+	tui_window* parent = win->parent;
+	bool geometry = false;
+	bool padding = false;
+	unsigned dirty = 0;
+	int ret;
+
+	if (mask & TUI_CFG_PARENT){
+		parent = cfg->parent ? cfg->parent : stdwin;
+	}
+	if ((ret = __tui_win_validate(win, parent, cfg, mask)) != TUI_OK){
+		return ret;
+	}
+
+	// nothing below can fail
+	if (parent != win->parent){
+		if (win->parent){
+			__tui_win_dirty(win->parent, TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT);
+			// constraints only relate siblings
+			__tui_cons_detach(win);
+			__tui_unlink(win);
+		}
+		__tui_link(parent, win);
+		dirty |= TUI_DIRTY_CONTENT;
+		geometry = true;
+	}
+	if ((mask & TUI_CFG_GRAVITY) && win->gravity != cfg->gravity){
+		__tui_grav_detach(win);
+		win->gravity = cfg->gravity;
+		__tui_grav_attach(win);
+		geometry = true;
+	}
+	if ((mask & TUI_CFG_WIDTH) && win->width != cfg->width){
+		win->width = cfg->width;
+		geometry = true;
+	}
+	if ((mask & TUI_CFG_HEIGHT) && win->height != cfg->height){
+		win->height = cfg->height;
+		geometry = true;
+	}
+	if ((mask & TUI_CFG_X_PADDING) && win->x_padding != cfg->x_padding){
+		win->x_padding = cfg->x_padding;
+		padding = true;
+	}
+	if ((mask & TUI_CFG_Y_PADDING) && win->y_padding != cfg->y_padding){
+		win->y_padding = cfg->y_padding;
+		padding = true;
+	}
+	if ((mask & TUI_CFG_CPOS) && win->cpos.type != cfg->cpos){
+		__tui_cpos_reset(win);
+		win->cpos.type = cfg->cpos;
+		dirty |= TUI_DIRTY_LAYOUT;
+	}
+	if ((mask & TUI_CFG_BORDER) && win->border != cfg->border){
+		win->border = cfg->border;
+		dirty |= TUI_DIRTY_CONTENT;
+	}
+
+	for (int attr = TUI_SET_PLACE_LEFTOF; attr <= TUI_SET_PLACE_BELOW; ++attr){
+		if (mask & (1u << attr)){
+			tui_constraint old = win->cons;
+			__tui_cons_place(win, __tui_cfg_place(cfg, attr), attr);
+			geometry |= memcmp(old.anchor, win->cons.anchor, sizeof(old.anchor)) != 0 ||
+				memcmp(old.before, win->cons.before, sizeof(old.before)) != 0;
+		}
+	}
+
+	// the window stays where it is, but the space left for its children changed
+	if (padding){
+		__tui_calcusablespace(win);
+		dirty |= TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT;
+	}
+	if (dirty){
+		__tui_win_dirty(win, dirty);
+	}
+	if (geometry){
+		__tui_win_geometry_changed(win);
+	}
+	return TUI_OK;
+}
+
 int tui_win_set(tui_window* win, int attr_type, ...){
-	tui_gravity g;
-	tui_window* wptr;
-	int n;
-	int q;
+	tui_win_config cfg;
+	unsigned mask;
 	va_list ap;
 
 	va_start(ap, attr_type);
 
 	switch (attr_type){
 	case TUI_SET_GRAVITY:
-		g = va_arg(ap, tui_gravity);
-		if (((g & TUI_GRAV_LEFT) && (g & TUI_GRAV_RIGHT)) ||
-			((g & TUI_GRAV_TOP)  && (g & TUI_GRAV_BOT))){
-			va_end(ap);
-			return TUI_EINVAL;
-		}
-		win->gravity = g;
+		cfg.gravity = va_arg(ap, tui_gravity);
 		break;
 	case TUI_SET_PARENT:
-		wptr = va_arg(ap, tui_window*);
-		win->parent = wptr;
+		cfg.parent = va_arg(ap, tui_window*);
+		break;
+	case TUI_SET_PLACE_LEFTOF:
+		cfg.leftof = va_arg(ap, tui_window*);
+		break;
+	case TUI_SET_PLACE_RIGHTOF:
+		cfg.rightof = va_arg(ap, tui_window*);
+		break;
+	case TUI_SET_PLACE_ABOVE:
+		cfg.above = va_arg(ap, tui_window*);
+		break;
+	case TUI_SET_PLACE_BELOW:
+		cfg.below = va_arg(ap, tui_window*);
 		break;
 	case TUI_SET_WIDTH:
-		n = va_arg(ap, int);
-		if (n < TUI_MATCH_PARENT){
-			va_end(ap);
-			return TUI_EINVAL;
-		}
-		win->width = n;
+		cfg.width = va_arg(ap, int);
 		break;
 	case TUI_SET_HEIGHT:
-		n = va_arg(ap, int);
-		if (n < TUI_MATCH_PARENT){
-			va_end(ap);
-			return TUI_EINVAL;
-		}
-		win->height = n;
+		cfg.height = va_arg(ap, int);
 		break;
 	case TUI_SET_X_PADDING:
-		n = va_arg(ap, int);
-		if (n < 0){
-			va_end(ap);
-			return TUI_EINVAL;
-		}
-		win->x_padding = n;
+		cfg.x_padding = va_arg(ap, int);
 		break;
 	case TUI_SET_Y_PADDING:
-		n = va_arg(ap, int);
-		if (n < 0){
-			va_end(ap);
-			return TUI_EINVAL;
-		}
-		win->y_padding = n;
+		cfg.y_padding = va_arg(ap, int);
 		break;
 	case TUI_SET_PADDING:
-		n = va_arg(ap, int);
-		q = tui_win_set(win, TUI_SET_X_PADDING, n);
-		if (q != TUI_OK){
-			va_end(ap);
-			return q;
-		}
-		q = tui_win_set(win, TUI_SET_Y_PADDING, n);
-		if (q != TUI_OK){
-			va_end(ap);
-			return q;
-		}
+		cfg.x_padding = va_arg(ap, int);
+		cfg.y_padding = cfg.x_padding;
+		break;
+	case TUI_SET_CPOS:
+		cfg.cpos = va_arg(ap, int);
+		break;
+	case TUI_SET_BORDER:
+		cfg.border = va_arg(ap, int);
 		break;
 	default:
 		va_end(ap);
 		return TUI_SET_BADATTR;
 	}
 	va_end(ap);
+
+	mask = attr_type == TUI_SET_PADDING ? TUI_CFG_PADDING : 1u << attr_type;
+	return tui_win_apply(win, &cfg, mask);
+}
+
+void tui_win_raise(tui_window* win){
+	tui_window* parent = win->parent;
+
+	if (!parent || parent->children.last == win){
+		return;
+	}
+	__tui_unlink(win);
+	__tui_link(parent, win);
+	// sibling order is also the order children are stacked against an edge in
+	__tui_win_dirty(parent, TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT);
+}
+
+void tui_win_lower(tui_window* win){
+	tui_window* parent = win->parent;
+
+	if (!parent || parent->children.first == win){
+		return;
+	}
+	__tui_unlink(win);
+	win->parent = parent;
+	win->z = parent->children.first->z - 1;
+	win->next = parent->children.first;
+	parent->children.first->prev = win;
+	parent->children.first = win;
+	parent->children.len++;
+	__tui_grav_attach(win);
+	__tui_cpos_touch(win);
+	// the siblings it went under have to be drawn on top of it again, and may be stacked against an edge differently
+	__tui_win_dirty(parent, TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT);
+}
+
+/**
+ * @brief Explicit stack for walking the window tree, so arbitrarily deep trees cannot overflow the call stack.
+ * It is kept between frames, so walking the tree does not allocate once it is large enough.
+ */
+static struct tui_walk{
+	struct tui_walk_frame{
+		tui_window* win;
+		/**
+		 * @brief The next child to visit.
+		 */
+		tui_window* next_child;
+		/**
+		 * @brief True if the window was drawn, so all of its children have to be drawn too.
+		 */
+		bool paint;
+		/**
+		 * @brief The area covered by the children drawn so far, when the window itself was not drawn.
+		 * Later siblings overlapping it have to be drawn on top again.
+		 */
+		tui_container drawn;
+		bool drawn_any;
+	}* arr;
+	size_t len;
+	size_t cap;
+}walk;
+
+static struct tui_walk_frame* __tui_walk_push(tui_window* win){
+	struct tui_walk_frame* frame;
+
+	if (walk.len == walk.cap){
+		size_t cap = walk.cap ? walk.cap * 2 : 64;
+		struct tui_walk_frame* tmp = realloc(walk.arr, cap * sizeof(*tmp));
+		if (!tmp){
+			return NULL;
+		}
+		walk.arr = tmp;
+		walk.cap = cap;
+	}
+
+	frame = &walk.arr[walk.len++];
+	frame->win = win;
+	frame->next_child = win->children.first;
+	frame->paint = false;
+	frame->drawn_any = false;
+	return frame;
+}
+
+static bool __tui_moved(tui_window* win){
+	tui_container* old = &win->laid_out;
+	tui_container* new = &win->pos.total;
+
+	if (old->row_top == new->row_top && old->row_bot == new->row_bot &&
+		old->col_left == new->col_left && old->col_right == new->col_right){
+		return false;
+	}
+	*old = *new;
+	return true;
+}
+
+static int __tui_calcchildren(tui_window* win){
+	switch (win->cpos.type){
+	case TUI_CPOS_CONSTRAINT:
+		return tui_cons_calcchildren(win);
+	default:
+		return tui_grav_calcchildren(win);
+	}
+}
+
+int tui_layout(tui_window* win){
+	int ret = TUI_OK;
+
+	walk.len = 0;
+	if (!__tui_walk_push(win)){
+		return TUI_ENOMEM;
+	}
+
+	while (walk.len > 0){
+		win = walk.arr[--walk.len].win;
+
+		if ((win->dirty & TUI_DIRTY_LAYOUT) && (ret = __tui_calcchildren(win)) != TUI_OK){
+			break;
+		}
+		win->dirty &= ~TUI_DIRTY_LAYOUT;
+
+		// only the children the strategy positioned, and the ones with something below them to lay out
+		while (win->relayout){
+			tui_window* child = win->relayout;
+
+			// the child's own children move with it, and the area it left has to be erased
+			if (__tui_moved(child)){
+				child->dirty |= TUI_DIRTY_LAYOUT;
+				win->dirty |= TUI_DIRTY_CONTENT | TUI_DIRTY_DESCENDANT;
+			}
+			if (((child->dirty & TUI_DIRTY_LAYOUT) || child->relayout) && !__tui_walk_push(child)){
+				ret = TUI_ENOMEM;
+				break;
+			}
+			__tui_win_unrelayout(child);
+		}
+		if (ret != TUI_OK){
+			break;
+		}
+	}
+
+	if (ret != TUI_OK){
+		// the next layout has to find the windows this one did not get to
+		__tui_win_relayout_up(win);
+		for (size_t i = 0; i < walk.len; ++i){
+			__tui_win_relayout_up(walk.arr[i].win);
+		}
+	}
+	walk.len = 0;
+	return ret;
+}
+
+static TUI_INLINE bool __tui_intersects(const tui_container* c1, const tui_container* c2){
+	return c1->col_left <= c2->col_right && c2->col_left <= c1->col_right &&
+		c1->row_top <= c2->row_bot && c2->row_top <= c1->row_bot;
+}
+
+static void __tui_union(tui_container* acc, const tui_container* c){
+	acc->row_top   = acc->row_top   < c->row_top   ? acc->row_top   : c->row_top;
+	acc->row_bot   = acc->row_bot   > c->row_bot   ? acc->row_bot   : c->row_bot;
+	acc->col_left  = acc->col_left  < c->col_left  ? acc->col_left  : c->col_left;
+	acc->col_right = acc->col_right > c->col_right ? acc->col_right : c->col_right;
+}
+
+static bool __tui_paint_push(tui_window* win, bool force){
+	struct tui_walk_frame* frame = __tui_walk_push(win);
+
+	if (!frame){
+		return false;
+	}
+	frame->paint = force || (win->dirty & TUI_DIRTY_CONTENT);
+	if (frame->paint){
+		tui_fb_clearrect(&screen, win->pos.total.row_top, win->pos.total.col_left, win->pos.total.row_bot, win->pos.total.col_right);
+		if (print_box(win) != 0 || print_content(win) != 0){
+			walk.len--;
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Draws every dirty window into the framebuffer in pre-order, going only into subtrees that are dirty.
+ */
+static int __tui_paint(tui_window* win){
+	walk.len = 0;
+	if (!__tui_paint_push(win, false)){
+		return TUI_ENOMEM;
+	}
+
+	while (walk.len > 0){
+		struct tui_walk_frame* frame = &walk.arr[walk.len - 1];
+		tui_window* child;
+		bool child_force;
+
+		win = frame->win;
+		if ((!frame->paint && !(win->dirty & TUI_DIRTY_DESCENDANT)) || !frame->next_child){
+			win->dirty &= ~(TUI_DIRTY_CONTENT | TUI_DIRTY_DESCENDANT);
+			walk.len--;
+			continue;
+		}
+
+		child = frame->next_child;
+		frame->next_child = child->next;
+		child_force = frame->paint || (frame->drawn_any && __tui_intersects(&frame->drawn, &child->pos.total));
+		if (!child_force && !child->dirty){
+			continue;
+		}
+
+		if (!frame->paint){
+			if (frame->drawn_any){
+				__tui_union(&frame->drawn, &child->pos.total);
+			}
+			else{
+				frame->drawn = child->pos.total;
+				frame->drawn_any = true;
+			}
+		}
+		// this may move the stack, so frame is not used afterwards
+		if (!__tui_paint_push(child, child_force)){
+			walk.len = 0;
+			return TUI_ENOMEM;
+		}
+	}
 	return TUI_OK;
 }
 
+void tui_win_set_draw(tui_window* win, tui_draw_fn draw, void* data){
+	win->draw = draw;
+	win->draw_data = data;
+	__tui_win_dirty(win, TUI_DIRTY_CONTENT);
+}
+
+void tui_win_invalidate(tui_window* win){
+	__tui_win_dirty(win, TUI_DIRTY_CONTENT);
+}
+
+/**
+ * @brief The state of tui_begin_update() and tui_end_update().
+ */
+static struct tui_update{
+	int depth;
+	/**
+	 * @brief The window tui_show() was last called with during the batch, or NULL.
+	 */
+	tui_window* deferred;
+}update;
+
+void tui_begin_update(void){
+	update.depth++;
+}
+
+int tui_end_update(void){
+	tui_window* win;
+
+	if (update.depth == 0){
+		return TUI_EINVAL;
+	}
+	if (--update.depth > 0 || !update.deferred){
+		return TUI_OK;
+	}
+	win = update.deferred;
+	update.deferred = NULL;
+	return tui_show(win);
+}
+
 int tui_show(tui_window* win){
-	tui_clear();
-	__tui_calcchildareas(win);
-	print_box(win);
-	for (size_t i = 0; i < win->children.len; ++i){
-		print_box(win->children.arr[i]);
+	uint64_t t_layout = 0;
+	uint64_t t_paint = 0;
+	uint64_t t_flush = 0;
+	uint64_t t_end;
+	int ret;
+
+	if (update.depth > 0){
+		update.deferred = win;
+		return TUI_OK;
 	}
-	return TUI_OK;
+
+	if ((ret = __tui_syncscreen()) != TUI_OK){
+		goto out;
+	}
+	if (win != screen_root){
+		tui_fb_clear(&screen);
+		win->dirty |= TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT;
+		screen_root = win;
+	}
+
+	t_layout = __tui_stats_now();
+	if ((ret = tui_layout(win)) != TUI_OK){
+		goto out;
+	}
+	t_paint = __tui_stats_now();
+	if ((ret = __tui_paint(win)) != TUI_OK){
+		goto out;
+	}
+	t_flush = __tui_stats_now();
+	ret = tui_fb_flush(&screen) == 0 ? TUI_OK : TUI_EIO;
+
+out:
+	// a frame that failed still ends here, so what it counted does not end up in the next one
+	t_end = __tui_stats_now();
+	if (t_layout){
+		TUI_STAT_ADD(layout_ns, (t_paint ? t_paint : t_end) - t_layout);
+	}
+	if (t_paint){
+		TUI_STAT_ADD(paint_ns, (t_flush ? t_flush : t_end) - t_paint);
+	}
+	if (t_flush){
+		TUI_STAT_ADD(flush_ns, t_end - t_flush);
+	}
+	__tui_stats_commit();
+	return ret;
 }
 
 int tui_hide(void){
@@ -349,6 +885,44 @@ int tui_hide(void){
 }
 
 int tui_win_free(tui_window* win){
-	free(win);
+	tui_window* root = win;
+	bool keep_root = win == stdwin;
+
+	if (win->parent){
+		__tui_win_dirty(win->parent, TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT);
+		__tui_cons_detach(win);
+		__tui_unlink(win);
+	}
+	else if (keep_root){
+		__tui_win_dirty(win, TUI_DIRTY_LAYOUT | TUI_DIRTY_CONTENT);
+	}
+
+	// post-order walk that unlinks each window once its children are gone, so arbitrarily deep trees need no extra memory
+	for (;;){
+		tui_window* parent;
+
+		if (win->children.last){
+			win = win->children.last;
+			continue;
+		}
+		if (win == screen_root){
+			screen_root = NULL;
+		}
+		if (win == update.deferred){
+			update.deferred = NULL;
+		}
+		if (win == root){
+			if (!keep_root){
+				__tui_pool_free(win);
+			}
+			break;
+		}
+
+		parent = win->parent;
+		__tui_cons_detach(win);
+		__tui_unlink(win);
+		__tui_pool_free(win);
+		win = parent;
+	}
 	return TUI_OK;
 }
@@ -10,6 +10,8 @@
 #define __TUI_WINDOW_H
 
 #include "../attribute.h"
+#include "border.h"
+#include "cpos_constraint.h"
 #include "cpos_gravity.h"
 #include <stdarg.h>
 #include <stdbool.h>
@@ -22,14 +24,56 @@ typedef struct tui_container{
 	int col_right;
 }tui_container;
 
+struct tui_window;
+
+/**
+ * @brief Draws what a window displays.
+ *
+ * @param win The window.
+ * @param fb The framebuffer to draw into.
+ * @param area Where to draw: the window's usable space, inside its border.
+ * Nothing outside of it may be drawn. It may be empty.
+ * @param data The pointer given to tui_win_set_draw().
+ *
+ * @return 0 on success, negative if out of memory.
+ */
+typedef int (*tui_draw_fn)(struct tui_window* win, tui_framebuffer* fb, const tui_container* area, void* data);
+
 typedef enum tui_cpos_type{
-	TUI_CPOS_GRAVITY
+	TUI_CPOS_GRAVITY,
+	TUI_CPOS_CONSTRAINT
 }tui_cpos_type;
 
+/**
+ * @brief How a window positions its children.
+ */
 typedef struct tui_cpos{
 	tui_cpos_type type;
 
-}
+	/**
+	 * @brief The children that have to be positioned again.
+	 */
+	struct tui_window* pending;
+
+	/**
+	 * @brief The usable area the children were last positioned in.
+	 * If it changed, every child has to be positioned again.
+	 */
+	tui_container solved_in;
+	bool solved;
+
+	/**
+	 * @brief The area TUI_CPOS_GRAVITY left for children that match their parent, as of the last layout.
+	 * If it changed, every such child has to be positioned again.
+	 */
+	tui_container remaining;
+
+	/**
+	 * @brief The children stacked against each edge by TUI_CPOS_GRAVITY.
+	 * These are kept up to date whatever the strategy is.
+	 */
+	tui_grav_bucket buckets[TUI_GRAV_BUCKETS];
+}tui_cpos;
 
 /**
  * @brief Main window structure.
@@ -67,19 +111,85 @@ typedef struct tui_window{
 	 */
 	int y_padding;
 
+	/**
+	 * @brief The style of the border drawn around the window.
+	 */
+	tui_border border;
+
+	/**
+	 * @brief Draws the window's contents, or NULL if it has nothing but a border and children.
+	 * It runs each time the window is drawn, after the border and before the children.
+	 */
+	tui_draw_fn draw;
+	void* draw_data;
+
 	/**
 	 * @brief The parent of the current window.
 	 */
 	struct tui_window* parent;
 
 	/**
-	 * @brief The children of the current window.
+	 * @brief The children of the current window, in z-order.
+	 * The first child is drawn first and the last child is drawn on top.
 	 */
 	struct tui_children{
-		struct tui_window** arr;
+		struct tui_window* first;
+		struct tui_window* last;
 		size_t len;
 	}children;
 
+	/**
+	 * @brief Where this window is in its parent's z-order. It only grows from the first child to the last,
+	 * so two siblings can be compared without walking the children between them.
+	 */
+	long long z;
+
+	/**
+	 * @brief The sibling below this window, or NULL if this is the first child.
+	 */
+	struct tui_window* prev;
+
+	/**
+	 * @brief The sibling above this window, or NULL if this is the last child.
+	 */
+	struct tui_window* next;
+
+	/**
+	 * @brief How the children of this window are positioned.
+	 */
+	tui_cpos cpos;
+
+	/**
+	 * @brief The neighbors of this window in its parent's gravity bucket.
+	 */
+	tui_grav_link grav;
+
+	/**
+	 * @brief Where this window is placed relative to its siblings.
+	 * This is only used if the parent uses TUI_CPOS_CONSTRAINT.
+	 */
+	tui_constraint cons;
+
+	/**
+	 * @brief The neighbors of this window in its parent's list of children that have to be positioned again.
+	 */
+	struct tui_window* pending_next;
+	struct tui_window* pending_prev;
+	bool pending;
+
+	/**
+	 * @brief The children the next layout has to look at: the ones that may have moved, and the ones with something below them to lay out.
+	 * No other child is visited, so a layout costs as much as the part of the tree that changed.
+	 */
+	struct tui_window* relayout;
+
+	/**
+	 * @brief The neighbors of this window in its parent's relayout list.
+	 */
+	struct tui_window* relayout_next;
+	struct tui_window* relayout_prev;
+	bool relayout_queued;
+
 	/**
 	 * @brief The true coordinates of this window.
 	 */
@@ -87,13 +197,30 @@ typedef struct tui_window{
 		tui_container total;
 		tui_container usable;
 	}pos;
+
+	/**
+	 * @brief The total area of this window as of the last layout.
+	 * This is used to find the windows that moved.
+	 */
+	tui_container laid_out;
+
+	/**
+	 * @brief What has to be recomputed or redrawn for this window.
+	 * This is a combination of the TUI_DIRTY_* flags.
+	 */
+	unsigned dirty;
 }tui_window;
 
+#define TUI_DIRTY_LAYOUT     (1 << 0) /**< The positions of the window's children have to be recomputed. */
+#define TUI_DIRTY_CONTENT    (1 << 1) /**< The window and everything in it has to be drawn again. */
+#define TUI_DIRTY_DESCENDANT (1 << 2) /**< A window somewhere below this one is dirty. */
+
 #define TUI_OK          (0)
 #define TUI_ENOMEM      (1)
 #define TUI_EINVAL      (2)
 #define TUI_SET_BADATTR (3)
 #define TUI_ENOSPC      (4)
+#define TUI_EIO         (5)
 
 #define TUI_SET_GRAVITY       (1)
 #define TUI_SET_PARENT        (2)
@@ -106,14 +233,90 @@ typedef struct tui_window{
 #define TUI_SET_X_PADDING     (9)
 #define TUI_SET_Y_PADDING     (10)
 #define TUI_SET_PADDING       (11)
+#define TUI_SET_CPOS          (12)
+#define TUI_SET_BORDER        (13)
 
 #define TUI_MATCH_PARENT (-1)
 
+#define TUI_CFG_GRAVITY       (1u << TUI_SET_GRAVITY)
+#define TUI_CFG_PARENT        (1u << TUI_SET_PARENT)
+#define TUI_CFG_PLACE_LEFTOF  (1u << TUI_SET_PLACE_LEFTOF)
+#define TUI_CFG_PLACE_RIGHTOF (1u << TUI_SET_PLACE_RIGHTOF)
+#define TUI_CFG_PLACE_ABOVE   (1u << TUI_SET_PLACE_ABOVE)
+#define TUI_CFG_PLACE_BELOW   (1u << TUI_SET_PLACE_BELOW)
+#define TUI_CFG_WIDTH         (1u << TUI_SET_WIDTH)
+#define TUI_CFG_HEIGHT        (1u << TUI_SET_HEIGHT)
+#define TUI_CFG_X_PADDING     (1u << TUI_SET_X_PADDING)
+#define TUI_CFG_Y_PADDING     (1u << TUI_SET_Y_PADDING)
+#define TUI_CFG_PADDING       (TUI_CFG_X_PADDING | TUI_CFG_Y_PADDING)
+#define TUI_CFG_CPOS          (1u << TUI_SET_CPOS)
+#define TUI_CFG_BORDER        (1u << TUI_SET_BORDER)
+#define TUI_CFG_ALL           (((1u << (TUI_SET_BORDER + 1)) - 1) & ~1u & ~(1u << TUI_SET_PADDING))
+
+/**
+ * @brief Several attributes of a window, to be changed together with tui_win_apply().
+ * Only the fields selected by the mask given to tui_win_apply() are read.
+ */
+typedef struct tui_win_config{
+	tui_gravity gravity;       /**< TUI_CFG_GRAVITY */
+	struct tui_window* parent; /**< TUI_CFG_PARENT. NULL means stdwin. */
+	struct tui_window* leftof; /**< TUI_CFG_PLACE_LEFTOF */
+	struct tui_window* rightof;/**< TUI_CFG_PLACE_RIGHTOF */
+	struct tui_window* above;  /**< TUI_CFG_PLACE_ABOVE */
+	struct tui_window* below;  /**< TUI_CFG_PLACE_BELOW */
+	int width;                 /**< TUI_CFG_WIDTH */
+	int height;                /**< TUI_CFG_HEIGHT */
+	int x_padding;             /**< TUI_CFG_X_PADDING */
+	int y_padding;             /**< TUI_CFG_Y_PADDING */
+	tui_cpos_type cpos;        /**< TUI_CFG_CPOS */
+	tui_border border;         /**< TUI_CFG_BORDER */
+}tui_win_config;
+
 /**
  * @brief Do not call this function directly. Use the stdwin macro instead.
  */
 TUI_CONST tui_window* __getstdwin();
 
+/**
+ * @brief Do not call this function directly. It is used by the child positioning strategies.
+ */
+int __tui_solvechildcollisions(tui_window* win, struct tui_container* out);
+
+/**
+ * @brief Do not call this function directly. It is used by the child positioning strategies.
+ */
+int __tui_calcusablespace(tui_window* win);
+
+/**
+ * @brief Do not call this function directly. It is used by the child positioning strategies.
+ * Tells a window's parent that the window has to be positioned again.
+ */
+void __tui_cpos_touch(tui_window* win);
+
+/**
+ * @brief Do not call this function directly. It is used by the child positioning strategies.
+ * Takes a window out of its parent's list of children to position again.
+ */
+void __tui_cpos_untouch(tui_window* win);
+
+/**
+ * @brief Do not call this function directly.
+ * Forgets how a window's children were positioned, so the next layout positions all of them.
+ */
+void __tui_cpos_reset(tui_window* win);
+
+/**
+ * @brief Do not call this function directly. It is used by the child positioning strategies.
+ * Tells the layout in progress that a child may have moved, so it is looked at once its parent is positioned.
+ */
+void __tui_win_relayout(tui_window* win);
+
+/**
+ * @brief Do not call this function directly. Use tui_win_invalidate() instead.
+ * Marks a window dirty and lets its ancestors know, so tui_show() can find it without visiting the whole tree.
+ */
+void __tui_win_dirty(tui_window* win, unsigned flags);
+
 /**
  * This macro refers to the standard window of this terminal.
  * This is the window that takes up all of the terminal's space.
@@ -124,11 +327,132 @@ TUI_CONST tui_window* __getstdwin();
 TUI_CONST const char* tui_strerr(int errc);
 
 int tui_win_make(tui_window* parent, tui_window** out);
+
+/**
+ * Makes many windows with the same parent at once.
+ * This is much faster than calling tui_win_make() n times, because the windows are allocated at once.<br>
+ * Either all of the windows are made or none of them are.
+ *
+ * @param parent The parent of the new windows. If this is NULL, stdwin is used.
+ * @param n The number of windows to make.
+ * @param out An array of n pointers that is filled with the new windows, from the bottom to the top of the z-order.
+ *
+ * @return TUI_OK on success, or TUI_ENOMEM if out of memory.
+ */
+int tui_win_make_n(tui_window* parent, size_t n, tui_window** out);
+
+/**
+ * Changes an attribute of a window.
+ * The windows affected by the change are marked dirty, so the next tui_show() lays them out again.<br>
+ * TUI_SET_PLACE_LEFTOF, TUI_SET_PLACE_RIGHTOF, TUI_SET_PLACE_ABOVE and TUI_SET_PLACE_BELOW take a sibling to place the window next to,
+ * or NULL to go back to the window's gravity on that axis. They are only used if the parent was given TUI_CPOS_CONSTRAINT with TUI_SET_CPOS.
+ *
+ * @param win The window.
+ * @param attr_type One of the TUI_SET_* constants, followed by its value.
+ *
+ * @return TUI_OK on success, TUI_EINVAL if the value is invalid, or TUI_SET_BADATTR if attr_type is not known.
+ */
 int tui_win_set(tui_window* win, int attr_type, ...);
 
+/**
+ * Changes several attributes of a window at once.
+ * Every selected value is checked before anything is changed, so either all of them are applied or none are.
+ * The affected windows are marked dirty once, however many attributes changed.<br>
+ * tui_win_set() is the same as calling this with a single attribute.
+ *
+ * @param win The window.
+ * @param cfg The new values.
+ * @param mask A combination of the TUI_CFG_* flags selecting which fields of cfg to apply.
+ * A mask may not place the window both left and right of, or both above and below, other windows.
+ *
+ * @return TUI_OK on success, TUI_EINVAL if a value is invalid, or TUI_SET_BADATTR if the mask has unknown flags.
+ */
+int tui_win_apply(tui_window* win, const tui_win_config* cfg, unsigned mask);
+
+/**
+ * Starts a batch of changes.
+ * Until the matching tui_end_update(), tui_show() only remembers which window to show,
+ * so changes to any number of windows are laid out and drawn together.<br>
+ * Batches can be nested. Only the outermost tui_end_update() draws.
+ */
+void tui_begin_update(void);
+
+/**
+ * Ends a batch of changes started by tui_begin_update().
+ * If tui_show() was called during the batch, the last window it was given is shown now.
+ *
+ * @return TUI_OK on success, TUI_EINVAL if no batch was started, or an error code from tui_show().
+ */
+int tui_end_update(void);
+
+/**
+ * Moves a window above all of its siblings, so it is drawn on top of them.
+ * Children stacked against the same edge of their parent are stacked in this order too, so the window moves to the end of its stack.
+ *
+ * @param win The window.
+ */
+void tui_win_raise(tui_window* win);
+
+/**
+ * Moves a window below all of its siblings, so they are drawn on top of it.
+ * It also moves to the front of the stack of children against the same edge of their parent.
+ *
+ * @param win The window.
+ */
+void tui_win_lower(tui_window* win);
+
+/**
+ * Sets what draws a window's contents.
+ * The window is drawn again by the next tui_show().
+ *
+ * @param win The window.
+ * @param draw The function that draws it, or NULL to draw nothing but the border.
+ * @param data Passed to draw as is.
+ */
+void tui_win_set_draw(tui_window* win, tui_draw_fn draw, void* data);
+
+/**
+ * Marks a window's contents as changed, so the next tui_show() draws it again.
+ * Only dirty windows are drawn, so this must be called after changing what a window displays.<br>
+ * Changes made through tui_win_set() mark the right windows automatically.
+ *
+ * @param win The window.
+ */
+void tui_win_invalidate(tui_window* win);
+
+/**
+ * Positions every window in a tree that needs it, without drawing anything.
+ * The whole depth of the tree is laid out, but only the subtrees that changed are visited.<br>
+ * tui_show() does this automatically.
+ *
+ * @param win The root of the tree.
+ *
+ * @return TUI_OK on success, or an error code on failure.
+ */
+int tui_layout(tui_window* win);
+
+/**
+ * Shows a window and its descendants.
+ * Only the windows that changed since the last call are laid out and drawn again.<br>
+ * The frame is sent with synchronized output where the terminal supports it, so it never shows half-drawn.
+ * @see tui_sync()
+ *
+ * @param win The window to show, usually stdwin.
+ *
+ * @return TUI_OK on success, or an error code on failure.
+ */
 int tui_show(tui_window* win);
 int tui_hide(void);
 
+/**
+ * Frees a window along with all of its descendants, and removes it from its parent.
+ * Freeing stdwin frees all of its descendants but keeps stdwin itself.<br>
+ * Any pointers to the freed windows are invalid afterwards.
+ *
+ * @param win The window.
+ *
+ * @return TUI_OK
+ */
 int tui_win_free(tui_window* win);
 
 #endif